@@ -19,6 +19,7 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    unsigned long long cache_hit_cnt;   /* Accesses served by a cache. */
   };
 
 /* List of all block devices. */
@@ -160,6 +161,15 @@ block_type (struct block *block)
   return block->type;
 }
 
+/* Records that a cache layered over BLOCK served an access to
+   one of its sectors without any device I/O.  Only used for
+   statistics. */
+void
+block_count_cache_hit (struct block *block)
+{
+  block->cache_hit_cnt++;
+}
+
 /* Prints statistics for each block device used for a Pintos role. */
 void
 block_print_stats (void)
@@ -171,9 +181,9 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
-          printf ("%s (%s): %llu reads, %llu writes\n",
+          printf ("%s (%s): %llu reads, %llu writes, %llu cache hits\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  block->read_cnt, block->write_cnt, block->cache_hit_cnt);
         }
     }
 }
@@ -200,6 +210,7 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->cache_hit_cnt = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
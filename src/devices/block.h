@@ -57,6 +57,7 @@ const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
 /* Statistics. */
+void block_count_cache_hit (struct block *);
 void block_print_stats (void);
 
 /* Lower-level interface to block device drivers. */
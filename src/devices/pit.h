@@ -3,6 +3,14 @@
 
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
+/* Largest count that can be loaded into a PIT counter. */
+#define PIT_MAX_COUNT 0xffff
+
 void pit_configure_channel (int channel, int mode, int frequency);
+void pit_start_oneshot (int channel, unsigned count);
+unsigned pit_read_counter (int channel);
 
 #endif /* devices/pit.h */
@@ -1,5 +1,6 @@
 #include "devices/timer.h"
 #include <debug.h>
+#include <heap.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
@@ -17,9 +18,48 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* Number of PIT cycles in one timer tick. */
+#define TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Shortest sleep, in PIT cycles, worth a one-shot timer
+   interrupt (about 10 us).  Shorter sleeps busy-wait. */
+#define MIN_SLEEP_CYCLES (PIT_HZ / 100000)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* PIT cycles elapsed since the start of the current tick, as of
+   the last time the PIT was programmed.  Always 0 while the PIT
+   runs in periodic mode. */
+static unsigned tick_phase;
+
+/* If nonzero, the PIT is armed in one-shot mode to interrupt
+   after this many cycles.  If zero, the PIT is in periodic mode
+   and interrupts at every tick boundary. */
+static unsigned oneshot_cycles;
+
+/* If true, the PIT is not reprogrammed to interrupt every tick
+   while the idle thread is running.  Controlled by kernel
+   command-line option "-tickless". */
+bool timer_tickless;
+
+/* True while the idle thread is halted in dynamic-tick mode. */
+static bool idle_tickless;
+
+/* Number of timer interrupts handled. */
+static int64_t interrupt_cnt;
+
+/* A thread sleeping for less than one timer tick. */
+struct sub_tick_sleeper
+  {
+    struct heap_elem elem;      /* Element in sub_tick_sleepers. */
+    int64_t deadline;           /* Wakeup time in PIT cycles since boot. */
+    struct semaphore wakeup;    /* Upped when DEADLINE passes. */
+  };
+
+/* Sub-tick sleepers, earliest deadline first. */
+static struct heap sub_tick_sleepers;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -29,12 +69,20 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void sub_tick_sleep (int64_t cycles);
+static bool deadline_less (const struct heap_elem *, const struct heap_elem *,
+                           void *aux);
+static bool elapsed_cycles (unsigned *);
+static int64_t current_cycles (void);
+static bool timer_sync (void);
+static void timer_program (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  heap_init (&sub_tick_sleepers, deadline_less, NULL);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -66,7 +114,12 @@ timer_calibrate (void)
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
 }
 
-/* Returns the number of timer ticks since the OS booted. */
+/* Returns the number of timer ticks since the OS booted.
+
+   While the idle thread is halted in dynamic-tick mode, this
+   count is brought up to date only when the PIT interrupts or
+   the idle thread is scheduled out, so interrupt handlers may
+   observe a slightly stale value. */
 int64_t
 timer_ticks (void) 
 {
@@ -109,7 +162,9 @@ timer_msleep (int64_t ms)
 }
 
 /* Sleeps for approximately US microseconds.  Interrupts must be
-   turned on. */
+   turned on.  Sleeps shorter than one timer tick are timed with a
+   one-shot PIT interrupt, so they do not busy-wait unless they
+   are shorter than about 10 us. */
 void
 timer_usleep (int64_t us) 
 {
@@ -117,7 +172,8 @@ timer_usleep (int64_t us)
 }
 
 /* Sleeps for approximately NS nanoseconds.  Interrupts must be
-   turned on. */
+   turned on.  As with timer_usleep(), sleeps shorter than a tick
+   use a one-shot PIT interrupt instead of busy-waiting. */
 void
 timer_nsleep (int64_t ns) 
 {
@@ -167,34 +223,253 @@ timer_ndelay (int64_t ns)
 void
 timer_print_stats (void) 
 {
-  printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  enum intr_level old_level = intr_disable ();
+  int64_t interrupts = interrupt_cnt;
+  intr_set_level (old_level);
+
+  printf ("Timer: %"PRId64" ticks, %"PRId64" interrupts\n",
+          timer_ticks (), interrupts);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In dynamic-tick mode, reprograms the PIT to
+   interrupt only when the next sleeping thread is due to wake
+   up (or as late as the PIT allows), instead of at every tick.
+
+   The MLFQS scheduler samples the load average every second, so
+   dynamic ticks are not used with it. */
+void
+timer_idle_enter (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || get_thread_mlfqs ())
+    return;
+
+  idle_tickless = true;
+  if (timer_sync ())
+    timer_program ();
+}
+
+/* Called with interrupts off when the idle thread is scheduled
+   out.  Brings the tick count up to date and returns the PIT to
+   interrupting at tick boundaries. */
+void
+timer_idle_exit (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!idle_tickless)
+    return;
+
+  idle_tickless = false;
+  if (timer_sync ())
+    timer_program ();
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args)
+timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  thread_tick ();
-
-  if (get_thread_mlfqs ()) {
-    /* mlfqs일 경우 timer_intr이 발생시마다 recent_cpu 1 증가*/ 
-    mlfqs_increment ();
-     /* 매 4tick마다 현재 스레드 priority 계산 */
-    if (ticks % 4 == 0)
-      mlfqs_priority (thread_current ());
-    /* 1초마다 load_avg, 모든 recent_cpu와 priority 계산 */
-    if (ticks % 100 == 0)
+  interrupt_cnt++;
+
+  /* A periodic interrupt ends exactly one tick.  A one-shot
+     interrupt may end part of a tick or, in dynamic-tick mode,
+     several ticks. */
+  tick_phase += oneshot_cycles != 0 ? oneshot_cycles : TICK_CYCLES;
+  while (tick_phase >= TICK_CYCLES)
     {
-      mlfqs_load_avg ();
-      mlfqs_recalc ();
+      tick_phase -= TICK_CYCLES;
+      ticks++;
+      thread_tick ();
+
+      if (get_thread_mlfqs ()) {
+        /* mlfqs일 경우 timer_intr이 발생시마다 recent_cpu 1 증가*/ 
+        mlfqs_increment ();
+         /* 매 4tick마다 현재 스레드 priority 계산 */
+        if (ticks % 4 == 0)
+          mlfqs_priority (thread_current ());
+        /* 1초마다 load_avg, 모든 recent_cpu와 priority 계산 */
+        if (ticks % 100 == 0)
+        {
+          mlfqs_load_avg ();
+          mlfqs_recalc ();
+        }
+        /* 밀린 decay를 스레드 몇 개씩 나누어 반영 */
+        mlfqs_sweep ();
+      }
     }
-  }
 
   /* 매 tick마다 sleep queue에서 깨어날 thread가 있는지 확인하여, 깨우는 함수 호출 */
   if (get_next_tick_to_awake () <= ticks) {
     thread_awake (ticks);
   }
+
+  /* Wake up sub-tick sleepers whose deadlines have passed. */
+  while (!heap_empty (&sub_tick_sleepers))
+    {
+      struct sub_tick_sleeper *s = heap_entry (heap_top (&sub_tick_sleepers),
+                                               struct sub_tick_sleeper, elem);
+      if (s->deadline > ticks * TICK_CYCLES + tick_phase)
+        break;
+      heap_pop (&sub_tick_sleepers);
+      sema_up (&s->wakeup);
+    }
+
+  timer_program ();
+}
+
+/* Stores into *CYCLES the number of PIT cycles that have elapsed
+   in the period the PIT is currently counting and returns true.
+   If that period has already ended and its interrupt is pending,
+   returns false instead.  Interrupts must be off. */
+static bool
+elapsed_cycles (unsigned *cycles)
+{
+  unsigned period = oneshot_cycles != 0 ? oneshot_cycles : TICK_CYCLES;
+  unsigned counter = pit_read_counter (0);
+
+  /* Check for a pending interrupt only after reading the
+     counter, so that a period that ends in between is not
+     mistaken for one that just began. */
+  if (intr_ext_pending (0x20))
+    return false;
+
+  /* In periodic mode the counter runs from TICK_CYCLES down to
+     1; in one-shot mode it runs from the armed count down to 0. */
+  *cycles = counter <= period ? period - counter : 0;
+  return true;
+}
+
+/* Returns the current time in PIT cycles since the OS booted.
+   Interrupts must be off. */
+static int64_t
+current_cycles (void)
+{
+  unsigned elapsed;
+
+  if (!elapsed_cycles (&elapsed))
+    elapsed = oneshot_cycles != 0 ? oneshot_cycles : TICK_CYCLES;
+  return ticks * TICK_CYCLES + tick_phase + elapsed;
+}
+
+/* Folds the PIT cycles elapsed in the current period into ticks
+   and tick_phase, in preparation for reprogramming the PIT with
+   timer_program().  Returns false, changing nothing, if the
+   current period already ended; timer_interrupt() will then
+   reprogram the PIT as soon as interrupts are enabled.
+   Interrupts must be off. */
+static bool
+timer_sync (void)
+{
+  unsigned elapsed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!elapsed_cycles (&elapsed))
+    return false;
+
+  /* No sleeper can be due before the current period ends, since
+     the PIT was programmed to interrupt by then, so ticks may be
+     advanced here without waking anyone. */
+  tick_phase += elapsed;
+  while (tick_phase >= TICK_CYCLES)
+    {
+      tick_phase -= TICK_CYCLES;
+      ticks++;
+    }
+  return true;
+}
+
+/* Programs the PIT to interrupt at the next timer event, given
+   that ticks and tick_phase are current.  Normally the PIT
+   interrupts at each tick boundary, but it is armed in one-shot
+   mode to reach a sub-tick sleeper's deadline, to get back to a
+   tick boundary afterward, or, while the idle thread is halted
+   in dynamic-tick mode, to skip over ticks in which nothing is
+   due.  Interrupts must be off. */
+static void
+timer_program (void)
+{
+  int64_t now = ticks * TICK_CYCLES + tick_phase;
+  int64_t next = INT64_MAX;
+  int64_t count;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!heap_empty (&sub_tick_sleepers))
+    next = heap_entry (heap_top (&sub_tick_sleepers),
+                       struct sub_tick_sleeper, elem)->deadline;
+
+  if (idle_tickless)
+    {
+      int64_t wakeup_tick = get_next_tick_to_awake ();
+      if (wakeup_tick != INT64_MAX && wakeup_tick * TICK_CYCLES < next)
+        next = wakeup_tick * TICK_CYCLES;
+    }
+  else if (next >= now + (TICK_CYCLES - tick_phase))
+    {
+      /* Nothing is due before the next tick boundary. */
+      if (tick_phase == 0)
+        {
+          if (oneshot_cycles != 0)
+            {
+              pit_configure_channel (0, 2, TIMER_FREQ);
+              oneshot_cycles = 0;
+            }
+          return;
+        }
+      next = now + (TICK_CYCLES - tick_phase);
+    }
+
+  count = next - now;
+  if (count < 1)
+    count = 1;
+  else if (count > PIT_MAX_COUNT)
+    count = PIT_MAX_COUNT;
+  pit_start_oneshot (0, count);
+  oneshot_cycles = count;
+}
+
+/* Returns true if sub-tick sleeper A's deadline is earlier than
+   B's. */
+static bool
+deadline_less (const struct heap_elem *a_, const struct heap_elem *b_,
+               void *aux UNUSED)
+{
+  const struct sub_tick_sleeper *a
+    = heap_entry (a_, struct sub_tick_sleeper, elem);
+  const struct sub_tick_sleeper *b
+    = heap_entry (b_, struct sub_tick_sleeper, elem);
+
+  return a->deadline < b->deadline;
+}
+
+/* Sleeps for CYCLES PIT cycles, which should be less than one
+   timer tick, by arming a one-shot PIT interrupt for the
+   deadline. */
+static void
+sub_tick_sleep (int64_t cycles)
+{
+  struct sub_tick_sleeper s;
+  enum intr_level old_level;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  sema_init (&s.wakeup, 0);
+
+  old_level = intr_disable ();
+  s.deadline = current_cycles () + cycles;
+  heap_push (&sub_tick_sleepers, &s.elem);
+
+  /* If the deadline comes before the next tick boundary, the PIT
+     must be reprogrammed now.  Otherwise timer_interrupt() will
+     take care of it at the boundary. */
+  if (s.deadline < (ticks + 1) * TICK_CYCLES && timer_sync ())
+    timer_program ();
+  intr_set_level (old_level);
+
+  sema_down (&s.wakeup);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -252,9 +527,14 @@ real_time_sleep (int64_t num, int32_t denom)
     }
   else 
     {
-      /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing. */
-      real_time_delay (num, denom); 
+      /* Otherwise, sleep until a one-shot timer interrupt, unless
+         the sleep is too short to be worth one. */
+      int64_t cycles = num * (PIT_HZ / 1000) / (denom / 1000);
+
+      if (cycles >= MIN_SLEEP_CYCLES)
+        sub_tick_sleep (cycles);
+      else
+        real_time_delay (num, denom); 
     }
 }
 
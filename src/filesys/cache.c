@@ -0,0 +1,360 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <hashmap.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sectors in the buffer cache. */
+#define CACHE_CNT 64
+
+/* Maximum number of queued read-ahead requests. */
+#define READ_AHEAD_MAX 64
+
+/* A cached sector of the file system device. */
+struct cache_entry
+  {
+    block_sector_t sector;              /* Sector held, if valid. */
+    bool valid;                         /* Holds a sector? */
+    bool dirty;                         /* Changed since read or written? */
+    bool accessed;                      /* Used since clock hand passed? */
+    bool busy;                          /* Device I/O under way? */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Sector contents. */
+  };
+
+/* The buffer cache. */
+static struct cache_entry entries[CACHE_CNT];
+
+/* Maps from sector number to the valid entry that holds it. */
+static struct hashmap sectors;
+
+/* Clock hand for replacement: index into ENTRIES. */
+static size_t hand;
+
+/* Number of dirty entries. */
+static size_t dirty_cnt;
+
+unsigned cache_flush_ms = 1000;
+unsigned cache_dirty_ratio = 50;
+
+/* Set by cache_done() to make the flusher thread exit. */
+static bool flusher_stop;
+
+/* Protects the cache and the read-ahead queue.  Device I/O is
+   done without it, with the entry marked busy; whoever wants a
+   busy entry waits on io_done. */
+static struct lock cache_lock;
+static struct condition io_done;
+
+/* Sectors queued for the read-ahead thread, a circular buffer
+   of READ_AHEAD_CNT elements starting at READ_AHEAD_HEAD.
+   read_ahead_ready is signaled when one is added. */
+static block_sector_t read_ahead_queue[READ_AHEAD_MAX];
+static size_t read_ahead_head;
+static size_t read_ahead_cnt;
+static struct condition read_ahead_ready;
+
+static struct cache_entry *get_entry (block_sector_t, bool read);
+static struct cache_entry *evict (void);
+static void do_io (struct cache_entry *, bool write);
+static void write_behind (size_t target);
+static void read_ahead_thread (void *aux);
+static void flusher_thread (void *aux);
+
+/* Initializes the buffer cache and starts the read-ahead and
+   flusher threads. */
+void
+cache_init (void)
+{
+  lock_init (&cache_lock);
+  cond_init (&io_done);
+  cond_init (&read_ahead_ready);
+  if (!hashmap_init (&sectors, hashmap_hash_uint, hashmap_less_uint, NULL)
+      || !hashmap_reserve (&sectors, CACHE_CNT))
+    PANIC ("couldn't allocate buffer cache map");
+  thread_create ("read-ahead", PRI_DEFAULT, read_ahead_thread, NULL);
+  if (cache_flush_ms > 0)
+    thread_create ("flusher", PRI_DEFAULT, flusher_thread, NULL);
+}
+
+/* Reads SIZE bytes starting at offset OFS within SECTOR of the
+   file system device into BUFFER, through the cache. */
+void
+cache_read (block_sector_t sector, void *buffer, int ofs, int size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&cache_lock);
+  e = get_entry (sector, true);
+  memcpy (buffer, e->data + ofs, size);
+  lock_release (&cache_lock);
+}
+
+/* Writes SIZE bytes from BUFFER into SECTOR of the file system
+   device, starting at offset OFS within the sector.  The data
+   reaches the device later, when the flusher thread runs, when
+   the sector is evicted, or when cache_flush() is called.  Only
+   if more than cache_dirty_ratio percent of the cache is dirty
+   does the caller wait to write some sectors back itself. */
+void
+cache_write (block_sector_t sector, const void *buffer, int ofs, int size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  /* A write of the whole sector need not read it first. */
+  lock_acquire (&cache_lock);
+  e = get_entry (sector, size < BLOCK_SECTOR_SIZE);
+  memcpy (e->data + ofs, buffer, size);
+  if (!e->dirty)
+    {
+      e->dirty = true;
+      dirty_cnt++;
+    }
+  if (dirty_cnt * 100 > cache_dirty_ratio * CACHE_CNT)
+    write_behind (cache_dirty_ratio * CACHE_CNT / 100);
+  lock_release (&cache_lock);
+}
+
+/* Asks the read-ahead thread to bring SECTOR into the cache, and
+   returns without waiting for it.  The request is dropped if
+   SECTOR is already cached or too many requests are pending. */
+void
+cache_read_ahead (block_sector_t sector)
+{
+  lock_acquire (&cache_lock);
+  if (read_ahead_cnt < READ_AHEAD_MAX
+      && hashmap_find (&sectors, sector) == NULL)
+    {
+      size_t tail = (read_ahead_head + read_ahead_cnt) % READ_AHEAD_MAX;
+      read_ahead_queue[tail] = sector;
+      read_ahead_cnt++;
+      cond_signal (&read_ahead_ready, &cache_lock);
+    }
+  lock_release (&cache_lock);
+}
+
+/* Writes every dirty sector in the cache to the device, and
+   waits for writes already under way in other threads to
+   finish, so that the device is up to date on return. */
+void
+cache_flush (void)
+{
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  write_behind (0);
+  for (i = 0; i < CACHE_CNT; i++)
+    while (entries[i].busy)
+      cond_wait (&io_done, &cache_lock);
+  lock_release (&cache_lock);
+}
+
+/* Stops the flusher thread and writes every dirty sector to the
+   device.  Called at shutdown. */
+void
+cache_done (void)
+{
+  lock_acquire (&cache_lock);
+  flusher_stop = true;
+  lock_release (&cache_lock);
+  cache_flush ();
+}
+
+/* Returns the entry for SECTOR, bringing it into the cache if
+   necessary.  If READ is false, the caller is about to overwrite
+   the whole sector, so a newly cached sector is not read from
+   the device.  The caller must hold cache_lock, which may be
+   released and reacquired while waiting for I/O. */
+static struct cache_entry *
+get_entry (block_sector_t sector, bool read)
+{
+  struct cache_entry *e;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (;;)
+    {
+      e = hashmap_find (&sectors, sector);
+      if (e == NULL)
+        break;
+      if (!e->busy)
+        {
+          block_count_cache_hit (fs_device);
+          e->accessed = true;
+          return e;
+        }
+      cond_wait (&io_done, &cache_lock);
+    }
+
+  /* Writing back a victim drops the lock, so someone else may
+     have cached SECTOR in the meantime. */
+  e = evict ();
+  if (hashmap_find (&sectors, sector) != NULL)
+    return get_entry (sector, read);
+
+  e->sector = sector;
+  e->valid = true;
+  e->dirty = false;
+  e->accessed = true;
+  hashmap_insert (&sectors, sector, e);
+  if (read)
+    do_io (e, false);
+  return e;
+}
+
+/* Chooses an entry to reuse with the clock algorithm, writing
+   back dirty entries on the way, and returns it, no longer
+   valid.  The caller must hold cache_lock, which may be released
+   and reacquired while waiting for I/O. */
+static struct cache_entry *
+evict (void)
+{
+  size_t busy_cnt = 0;
+
+  for (;;)
+    {
+      struct cache_entry *e = &entries[hand];
+
+      hand = (hand + 1) % CACHE_CNT;
+      if (e->busy)
+        {
+          /* Every entry is busy: wait for some I/O to finish. */
+          if (++busy_cnt >= CACHE_CNT)
+            {
+              cond_wait (&io_done, &cache_lock);
+              busy_cnt = 0;
+            }
+          continue;
+        }
+      busy_cnt = 0;
+
+      if (!e->valid)
+        return e;
+      if (e->accessed)
+        e->accessed = false;
+      else if (e->dirty)
+        {
+          /* Clean it now; it is a candidate again next time
+             round unless someone uses it in the meantime. */
+          do_io (e, true);
+        }
+      else
+        {
+          hashmap_delete (&sectors, e->sector);
+          e->valid = false;
+          return e;
+        }
+    }
+}
+
+/* Reads E's sector into E, or writes it back if WRITE is true,
+   with cache_lock released and E marked busy meanwhile.  The
+   caller must hold cache_lock. */
+static void
+do_io (struct cache_entry *e, bool write)
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+  ASSERT (!e->busy);
+
+  e->busy = true;
+  if (write)
+    {
+      e->dirty = false;
+      dirty_cnt--;
+    }
+  lock_release (&cache_lock);
+
+  if (write)
+    block_write (fs_device, e->sector, e->data);
+  else
+    block_read (fs_device, e->sector, e->data);
+
+  lock_acquire (&cache_lock);
+  e->busy = false;
+  cond_broadcast (&io_done, &cache_lock);
+}
+
+/* Writes dirty entries back, in ascending order of sector
+   number to keep the disk head moving one way, until no more
+   than TARGET are dirty.  The caller must hold cache_lock, which
+   is released and reacquired around each write. */
+static void
+write_behind (size_t target)
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  while (dirty_cnt > target)
+    {
+      struct cache_entry *dirty[CACHE_CNT];
+      size_t cnt = 0;
+      size_t i, j;
+
+      /* Insertion sort the dirty entries by sector.  Entries
+         under I/O are never dirty. */
+      for (i = 0; i < CACHE_CNT; i++)
+        {
+          struct cache_entry *e = &entries[i];
+
+          if (!e->valid || !e->dirty)
+            continue;
+          for (j = cnt; j > 0 && dirty[j - 1]->sector > e->sector; j--)
+            dirty[j] = dirty[j - 1];
+          dirty[j] = e;
+          cnt++;
+        }
+
+      ASSERT (cnt > 0);
+
+      /* Entries may change while we write, so check again. */
+      for (i = 0; i < cnt && dirty_cnt > target; i++)
+        if (dirty[i]->valid && dirty[i]->dirty && !dirty[i]->busy)
+          do_io (dirty[i], true);
+    }
+}
+
+/* Read-ahead thread.  Reads queued sectors into the cache, so
+   that a process reading a file sequentially finds the sectors
+   ahead of it already there instead of waiting on the disk. */
+static void
+read_ahead_thread (void *aux UNUSED)
+{
+  lock_acquire (&cache_lock);
+  for (;;)
+    {
+      block_sector_t sector;
+
+      while (read_ahead_cnt == 0)
+        cond_wait (&read_ahead_ready, &cache_lock);
+      sector = read_ahead_queue[read_ahead_head];
+      read_ahead_head = (read_ahead_head + 1) % READ_AHEAD_MAX;
+      read_ahead_cnt--;
+
+      if (hashmap_find (&sectors, sector) == NULL)
+        get_entry (sector, true);
+    }
+}
+
+/* Flusher thread.  Every cache_flush_ms milliseconds, writes all
+   dirty sectors back, so that writers rarely find eviction
+   waiting on a write-back and little is lost in a crash.  Exits
+   once cache_done() has been called. */
+static void
+flusher_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_msleep (cache_flush_ms);
+      lock_acquire (&cache_lock);
+      if (flusher_stop)
+        break;
+      write_behind (0);
+      lock_release (&cache_lock);
+    }
+  lock_release (&cache_lock);
+}
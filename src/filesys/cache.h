@@ -0,0 +1,21 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include "devices/block.h"
+
+/* Milliseconds between runs of the flusher thread, which writes
+   dirty sectors back.  Set with -flush-ms=MS; 0 disables it. */
+extern unsigned cache_flush_ms;
+
+/* Percentage of the cache that may be dirty before writers must
+   write sectors back themselves.  Set with -dirty-ratio=PCT. */
+extern unsigned cache_dirty_ratio;
+
+void cache_init (void);
+void cache_read (block_sector_t, void *buffer, int ofs, int size);
+void cache_write (block_sector_t, const void *buffer, int ofs, int size);
+void cache_read_ahead (block_sector_t);
+void cache_flush (void);
+void cache_done (void);
+
+#endif /* filesys/cache.h */
@@ -3,32 +3,58 @@
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
+/* Limits on a file's read-ahead window, in sectors. */
+#define READ_AHEAD_MIN 4
+#define READ_AHEAD_MAX 32
+
 /* An open file. */
 struct file 
   {
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+
+    /* Sequential read detection. */
+    off_t ra_next;              /* Where a sequential read would start. */
+    off_t ra_end;               /* End of data already read ahead. */
+    int ra_window;              /* Read-ahead window in sectors, or 0. */
   };
 
+static void read_ahead (struct file *, off_t ofs, off_t size);
+
+/* Cache of `struct file's. */
+static struct kmem_cache *file_cache;
+
+/* Initializes the file module. */
+void
+file_init (void) 
+{
+  file_cache = kmem_cache_create ("file", sizeof (struct file), NULL);
+  if (file_cache == NULL)
+    PANIC ("Can't create file cache.");
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) 
 {
-  struct file *file = calloc (1, sizeof *file);
+  struct file *file = kmem_cache_zalloc (file_cache);
   if (inode != NULL && file != NULL)
     {
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->ra_next = 0;
+      file->ra_end = 0;
+      file->ra_window = 0;
       return file;
     }
   else
     {
       inode_close (inode);
-      free (file);
+      kmem_cache_free (file_cache, file);
       return NULL; 
     }
 }
@@ -49,7 +75,7 @@ file_close (struct file *file)
     {
       file_allow_write (file);
       inode_close (file->inode);
-      free (file); 
+      kmem_cache_free (file_cache, file); 
     }
 }
 
@@ -69,6 +95,7 @@ off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
   off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  read_ahead (file, file->pos, bytes_read);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -87,9 +114,8 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at the file's current position.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk fills up.
+   Writing past end of file grows the file.
    Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
@@ -102,9 +128,8 @@ file_write (struct file *file, const void *buffer, off_t size)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk fills up.
+   Writing past end of file grows the file.
    The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
@@ -166,3 +191,38 @@ file_tell (struct file *file)
   ASSERT (file != NULL);
   return file->pos;
 }
+
+/* Notes that SIZE bytes were just read from FILE at offset OFS.
+   If that continues a sequential stream of reads, asks for the
+   data ahead of the stream to be read into the buffer cache in
+   the background.  The window starts at READ_AHEAD_MIN sectors
+   and doubles with each sequential read, up to READ_AHEAD_MAX;
+   any other read resets it. */
+static void
+read_ahead (struct file *file, off_t ofs, off_t size)
+{
+  off_t end = ofs + size;
+  off_t target;
+
+  if (ofs != file->ra_next || size == 0)
+    {
+      file->ra_next = file->ra_end = end;
+      file->ra_window = 0;
+      return;
+    }
+
+  if (file->ra_window == 0)
+    file->ra_window = READ_AHEAD_MIN;
+  else if (file->ra_window < READ_AHEAD_MAX)
+    file->ra_window *= 2;
+  file->ra_next = end;
+  if (file->ra_end < end)
+    file->ra_end = end;
+
+  target = end + file->ra_window * BLOCK_SECTOR_SIZE;
+  if (target > file->ra_end)
+    {
+      inode_read_ahead (file->inode, file->ra_end, target - file->ra_end);
+      file->ra_end = target;
+    }
+}
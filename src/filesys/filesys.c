@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
@@ -21,7 +22,10 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
 
   if (format) 
@@ -36,6 +40,7 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  cache_done ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
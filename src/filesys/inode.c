@@ -2,7 +2,10 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
@@ -10,16 +13,52 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of sector pointers in an on-disk inode, in an indirect
+   block, and reachable through a doubly indirect block. */
+#define DIRECT_CNT 124
+#define INDIRECT_CNT (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+#define DBL_INDIRECT_CNT (INDIRECT_CNT * INDIRECT_CNT)
+
+/* Most sectors a file can have. */
+#define MAX_SECTORS (DIRECT_CNT + INDIRECT_CNT + DBL_INDIRECT_CNT)
+
+/* Largest file kept inside its own inode sector, in place of
+   the sector pointers. */
+#define INLINE_MAX (BLOCK_SECTOR_SIZE - 2 * sizeof (uint32_t))
+
+/* No indirect block is cached. */
+#define NO_LEAF SIZE_MAX
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    union
+      {
+        /* Files longer than INLINE_MAX bytes. */
+        struct
+          {
+            block_sector_t direct[DIRECT_CNT]; /* First data sectors. */
+            block_sector_t indirect;    /* Indirect block. */
+            block_sector_t dbl_indirect; /* Doubly indirect block. */
+          };
+
+        /* Files of INLINE_MAX bytes or less. */
+        uint8_t inline_data[INLINE_MAX];
+      };
   };
 
+/* Returns true if a file LENGTH bytes long keeps its data in its
+   inode.  Files only grow, so a file moves out of its inode once
+   and never comes back. */
+static inline bool
+is_inline (off_t length)
+{
+  return length <= (off_t) INLINE_MAX;
+}
+
 /* Returns the number of sectors to allocate for an inode SIZE
    bytes long. */
 static inline size_t
@@ -36,32 +75,263 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned write_cnt;                 /* Number of writes, to spot changes. */
     struct inode_disk data;             /* Inode content. */
+
+    /* Copy of the indirect block last used to find a data
+       sector, so that sequential access past the direct
+       pointers reads each indirect block only once. */
+    size_t leaf;                        /* Its number, or NO_LEAF. */
+    block_sector_t leaf_sector;         /* Its sector. */
+    block_sector_t leaf_data[INDIRECT_CNT]; /* Its contents. */
   };
 
+/* Indirect blocks are numbered in file order: leaf 0 is the
+   inode's indirect block, leaf N > 0 is entry N - 1 of its doubly
+   indirect block.  Returns the leaf that holds the pointer to
+   data sector IDX, which must not be a direct sector. */
+static inline size_t
+idx_to_leaf (size_t idx)
+{
+  ASSERT (idx >= DIRECT_CNT);
+  return (idx - DIRECT_CNT) / INDIRECT_CNT;
+}
+
+/* Returns the number of indirect blocks needed by a file with
+   SECTORS data sectors. */
+static inline size_t
+leaf_cnt (size_t sectors)
+{
+  return sectors > DIRECT_CNT ? idx_to_leaf (sectors - 1) + 1 : 0;
+}
+
+/* Returns the sector of INODE's indirect block LEAF, which must
+   already be allocated. */
+static block_sector_t
+leaf_to_sector (const struct inode *inode, size_t leaf)
+{
+  block_sector_t sector;
+
+  if (leaf == 0)
+    return inode->data.indirect;
+  cache_read (inode->data.dbl_indirect, &sector,
+              (leaf - 1) * sizeof sector, sizeof sector);
+  return sector;
+}
+
+/* Makes indirect block LEAF of INODE the cached one. */
+static void
+load_leaf (struct inode *inode, size_t leaf)
+{
+  if (inode->leaf != leaf)
+    {
+      inode->leaf_sector = leaf_to_sector (inode, leaf);
+      cache_read (inode->leaf_sector, inode->leaf_data, 0,
+                  BLOCK_SECTOR_SIZE);
+      inode->leaf = leaf;
+    }
+}
+
+/* Returns the sector that holds data sector IDX of INODE, which
+   must already be allocated. */
+static block_sector_t
+idx_to_sector (struct inode *inode, size_t idx)
+{
+  if (idx < DIRECT_CNT)
+    return inode->data.direct[idx];
+  load_leaf (inode, idx_to_leaf (idx));
+  return inode->leaf_data[(idx - DIRECT_CNT) % INDIRECT_CNT];
+}
+
 /* Returns the block device sector that contains byte offset POS
    within INODE.
    Returns -1 if INODE does not contain data for a byte at offset
    POS. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+byte_to_sector (struct inode *inode, off_t pos) 
 {
   ASSERT (inode != NULL);
   if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
+    return idx_to_sector (inode, pos / BLOCK_SECTOR_SIZE);
   else
     return -1;
 }
 
+/* Allocates a sector, fills it with zeros, and stores it into
+   *SECTORP.  Returns true if successful, false if the disk is
+   full. */
+static bool
+allocate_zeroed (block_sector_t *sectorp)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+
+  if (!free_map_allocate (1, sectorp))
+    return false;
+  cache_write (*sectorp, zeros, 0, BLOCK_SECTOR_SIZE);
+  return true;
+}
+
+/* Allocates data sector IDX of INODE, along with any indirect
+   block needed to point to it.  Sectors before IDX must already
+   be allocated.  Returns true if successful, false if the disk
+   is full. */
+static bool
+allocate_idx (struct inode *inode, size_t idx)
+{
+  struct inode_disk *data = &inode->data;
+  block_sector_t sector;
+  size_t leaf, slot;
+
+  if (idx >= MAX_SECTORS)
+    return false;
+  if (idx < DIRECT_CNT)
+    return allocate_zeroed (&data->direct[idx]);
+
+  /* The first data sector under a leaf brings the leaf itself,
+     and the first leaf under the doubly indirect block brings
+     that one too. */
+  leaf = idx_to_leaf (idx);
+  slot = (idx - DIRECT_CNT) % INDIRECT_CNT;
+  if (slot == 0)
+    {
+      if (leaf == 0)
+        {
+          if (!allocate_zeroed (&data->indirect))
+            return false;
+        }
+      else
+        {
+          if (leaf == 1 && !allocate_zeroed (&data->dbl_indirect))
+            return false;
+          if (!allocate_zeroed (&sector))
+            {
+              if (leaf == 1)
+                free_map_release (data->dbl_indirect, 1);
+              return false;
+            }
+          cache_write (data->dbl_indirect, &sector,
+                       (leaf - 1) * sizeof sector, sizeof sector);
+        }
+    }
+
+  /* Point the leaf at a new data sector.  If there is none,
+     give back the blocks allocated just for it above. */
+  load_leaf (inode, leaf);
+  if (!allocate_zeroed (&sector))
+    {
+      if (slot == 0)
+        {
+          free_map_release (inode->leaf_sector, 1);
+          if (leaf == 1)
+            free_map_release (data->dbl_indirect, 1);
+          inode->leaf = NO_LEAF;
+        }
+      return false;
+    }
+  inode->leaf_data[slot] = sector;
+  cache_write (inode->leaf_sector, &sector, slot * sizeof sector,
+               sizeof sector);
+  return true;
+}
+
+/* Moves the data of INODE, which must be inline, out to a data
+   sector of its own, and clears the sector pointers the data
+   was stored in.  Returns true if successful, false if the disk
+   is full. */
+static bool
+move_out_inline (struct inode *inode)
+{
+  block_sector_t sector;
+
+  ASSERT (is_inline (inode->data.length));
+
+  if (!allocate_zeroed (&sector))
+    return false;
+  cache_write (sector, inode->data.inline_data, 0, inode->data.length);
+  memset (inode->data.inline_data, 0, INLINE_MAX);
+  inode->data.direct[0] = sector;
+  return true;
+}
+
+/* Extends INODE to LENGTH bytes, allocating zeroed sectors as
+   needed, and writes the new length to disk.  If the disk fills
+   up, extends INODE as far as the sectors that could be
+   allocated go.  Returns true if INODE reached LENGTH. */
+static bool
+inode_extend (struct inode *inode, off_t length)
+{
+  size_t sectors = bytes_to_sectors (inode->data.length);
+  size_t new_sectors = bytes_to_sectors (length);
+  off_t old_length = inode->data.length;
+  bool success = true;
+
+  ASSERT (length >= old_length);
+
+  /* Inline data past the old length is already zero, so an
+     inline file grows just by changing its length. */
+  if (is_inline (length))
+    new_sectors = sectors;
+  else if (is_inline (old_length))
+    {
+      if (move_out_inline (inode))
+        sectors = 1;
+      else
+        {
+          length = INLINE_MAX;
+          new_sectors = sectors;
+          success = false;
+        }
+    }
+
+  for (; sectors < new_sectors; sectors++)
+    if (!allocate_idx (inode, sectors))
+      {
+        length = sectors * BLOCK_SECTOR_SIZE;
+        success = false;
+        break;
+      }
+  if (length > old_length)
+    {
+      inode->data.length = length;
+      cache_write (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+    }
+  return success;
+}
+
+/* Releases INODE's data sectors and indirect blocks. */
+static void
+inode_release (struct inode *inode)
+{
+  size_t sectors = bytes_to_sectors (inode->data.length);
+  size_t leaves = leaf_cnt (sectors);
+  size_t i;
+
+  if (is_inline (inode->data.length))
+    return;
+  for (i = 0; i < sectors; i++)
+    free_map_release (idx_to_sector (inode, i), 1);
+  for (i = 0; i < leaves; i++)
+    free_map_release (leaf_to_sector (inode, i), 1);
+  if (leaves > 1)
+    free_map_release (inode->data.dbl_indirect, 1);
+  inode->leaf = NO_LEAF;
+}
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of `struct inode's. */
+static struct kmem_cache *inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode), NULL);
+  if (inode_cache == NULL)
+    PANIC ("Can't create inode cache.");
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -73,6 +343,7 @@ bool
 inode_create (block_sector_t sector, off_t length)
 {
   struct inode_disk *disk_inode = NULL;
+  struct inode *inode;
   bool success = false;
 
   ASSERT (length >= 0);
@@ -81,26 +352,23 @@ inode_create (block_sector_t sector, off_t length)
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
+  /* Write an empty inode, then grow it to LENGTH the same way
+     a write past end of file would. */
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
-      disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
-        {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
+      cache_write (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
       free (disk_inode);
+
+      inode = inode_open (sector);
+      if (inode != NULL)
+        {
+          success = inode_extend (inode, length);
+          if (!success)
+            inode_release (inode);
+          inode_close (inode);
+        }
     }
   return success;
 }
@@ -127,7 +395,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -136,8 +404,10 @@ inode_open (block_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  inode->leaf = NO_LEAF;
+  cache_read (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
   return inode;
 }
 
@@ -176,12 +446,11 @@ inode_close (struct inode *inode)
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          inode_release (inode);
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      kmem_cache_free (inode_cache, inode); 
     }
 }
 
@@ -202,7 +471,17 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+
+  /* Inline data came into memory along with the inode. */
+  if (is_inline (inode_length (inode)))
+    {
+      if (size > inode_length (inode) - offset)
+        size = inode_length (inode) - offset;
+      if (size <= 0)
+        return 0;
+      memcpy (buffer, inode->data.inline_data + offset, size);
+      return size;
+    }
 
   while (size > 0) 
     {
@@ -220,51 +499,66 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+      cache_read (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
 
   return bytes_read;
 }
 
+/* Asks for the sectors that hold SIZE bytes of INODE starting
+   at position OFFSET to be read into the buffer cache in the
+   background.  Bytes past the end of INODE are ignored. */
+void
+inode_read_ahead (struct inode *inode, off_t offset, off_t size)
+{
+  off_t end = offset + size;
+
+  if (is_inline (inode_length (inode)))
+    return;
+  if (end > inode_length (inode))
+    end = inode_length (inode);
+  for (offset -= offset % BLOCK_SECTOR_SIZE; offset < end;
+       offset += BLOCK_SECTOR_SIZE)
+    cache_read_ahead (byte_to_sector (inode, offset));
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk fills up.  Writing past end of file
+   extends INODE, and any gap before OFFSET reads back as
+   zeros. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  if (offset + size > inode_length (inode))
+    inode_extend (inode, offset + size);
+
+  /* Inline data is written back as part of the inode sector. */
+  if (is_inline (inode_length (inode)))
+    {
+      if (size > inode_length (inode) - offset)
+        size = inode_length (inode) - offset;
+      if (size <= 0)
+        return 0;
+      memcpy (inode->data.inline_data + offset, buffer, size);
+      cache_write (inode->sector, buffer,
+                   offsetof (struct inode_disk, inline_data) + offset, size);
+      inode->write_cnt++;
+      return size;
+    }
+
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
@@ -281,38 +575,18 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      /* The cache reads the sector first unless the chunk covers
+         all of it. */
+      cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+                   chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+  if (bytes_written > 0)
+    inode->write_cnt++;
 
   return bytes_written;
 }
@@ -343,3 +617,14 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Returns the number of calls to inode_write_at() that have
+   changed INODE since it was opened.  Anything that caches
+   INODE's contents while keeping it open can compare this
+   against the count when it read them to see if they are
+   stale. */
+unsigned
+inode_get_write_cnt (const struct inode *inode)
+{
+  return inode->write_cnt;
+}
@@ -27,6 +27,7 @@ typedef unsigned long elem_type;
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
+    size_t first_free;  /* Every bit before this one is true. */
     elem_type *bits;    /* Elements that represent bits. */
   };
 
@@ -68,6 +69,58 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns an elem_type in which the bits corresponding to bit
+   indexes START through END within a single element, inclusive,
+   are set to 1 and the rest are set to 0. */
+static inline elem_type
+range_mask (size_t start, size_t end)
+{
+  elem_type lo = (elem_type) -1 << (start % ELEM_BITS);
+  elem_type hi = (elem_type) -1 >> (ELEM_BITS - 1 - end % ELEM_BITS);
+  return lo & hi;
+}
+
+/* Returns the index of the least significant 1 bit in W, which
+   must be nonzero. */
+static inline size_t
+first_one (elem_type w)
+{
+  elem_type idx;
+  asm ("bsfl %1, %0" : "=r" (idx) : "rm" (w) : "cc");
+  return idx;
+}
+
+/* Returns the index of the first bit in B at or after START
+   that is set to VALUE, or B's size if there is none.
+
+   Whole elements with no bit set to VALUE are skipped at once,
+   and the bit within an element is found with a single `bsf'
+   instruction. */
+static size_t
+find_next (const struct bitmap *b, size_t start, bool value)
+{
+  size_t idx, cnt;
+  elem_type flip = value ? 0 : (elem_type) -1;
+  elem_type w;
+
+  if (start >= b->bit_cnt)
+    return b->bit_cnt;
+
+  idx = elem_idx (start);
+  cnt = elem_cnt (b->bit_cnt);
+  w = (b->bits[idx] ^ flip) & ((elem_type) -1 << (start % ELEM_BITS));
+  while (w == 0)
+    {
+      if (++idx >= cnt)
+        return b->bit_cnt;
+      w = b->bits[idx] ^ flip;
+    }
+
+  /* The unused bits of the last element have arbitrary values. */
+  start = idx * ELEM_BITS + first_one (w);
+  return start < b->bit_cnt ? start : b->bit_cnt;
+}
 
 /* Creation and destruction. */
 
@@ -82,6 +135,7 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
+      b->first_free = 0;
       b->bits = malloc (byte_cnt (bit_cnt));
       if (b->bits != NULL || bit_cnt == 0)
         {
@@ -104,6 +158,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
   ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
   b->bit_cnt = bit_cnt;
+  b->first_free = 0;
   b->bits = (elem_type *) (b + 1);
   bitmap_set_all (b, false);
   return b;
@@ -177,6 +232,8 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
   asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  if (bit_idx < b->first_free)
+    b->first_free = bit_idx;
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -192,6 +249,8 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
   asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  if (bit_idx < b->first_free)
+    b->first_free = bit_idx;
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -214,18 +273,38 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, a whole element at a
+   time. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end, idx;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  if (cnt == 0)
+    return;
+
+  end = start + cnt - 1;
+  for (idx = elem_idx (start); idx <= elem_idx (end); idx++)
+    {
+      size_t first = idx == elem_idx (start) ? start : idx * ELEM_BITS;
+      size_t last = idx == elem_idx (end) ? end : idx * ELEM_BITS + ELEM_BITS - 1;
+      elem_type mask = range_mask (first, last);
+
+      if (value)
+        asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+    }
+
+  if (!value && start < b->first_free)
+    b->first_free = start;
+  else if (value && start <= b->first_free && b->first_free <= end)
+    b->first_free = end + 1;
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -251,16 +330,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return cnt > 0 && find_next (b, start, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -292,20 +366,38 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   The scan alternates between finding the next bit set to VALUE,
+   which starts a candidate group, and the next bit set to
+   !VALUE, which ends it, so it takes time proportional to the
+   number of elements and groups it passes over rather than to
+   the number of bits times CNT.  A search for false bits starts
+   no earlier than the first bit that might be false. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
+  if (cnt > b->bit_cnt)
+    return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+  if (!value && start < b->first_free)
+    start = b->first_free;
+
+  while (start + cnt <= b->bit_cnt)
     {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t end;
+
+      start = find_next (b, start, value);
+      if (start + cnt > b->bit_cnt)
+        break;
+      end = find_next (b, start, !value);
+      if (end - start >= cnt)
+        return start;
+      start = end;
     }
   return BITMAP_ERROR;
 }
@@ -320,7 +412,15 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-  size_t idx = bitmap_scan (b, start, cnt, value);
+  size_t idx;
+
+  /* Move the hint past any true bits that were set one at a
+     time, so that they are not passed over again by every
+     later search. */
+  if (!value)
+    b->first_free = find_next (b, b->first_free, false);
+
+  idx = bitmap_scan (b, start, cnt, value);
   if (idx != BITMAP_ERROR) 
     bitmap_set_multiple (b, idx, cnt, !value);
   return idx;
@@ -347,6 +447,7 @@ bitmap_read (struct bitmap *b, struct file *file)
       off_t size = byte_cnt (b->bit_cnt);
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      b->first_free = 0;
     }
   return success;
 }
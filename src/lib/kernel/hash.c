@@ -12,12 +12,31 @@
 #define list_elem_to_hash_elem(LIST_ELEM)                       \
         list_entry(LIST_ELEM, struct hash_elem, list_elem)
 
+/* Element per bucket ratios. */
+#define MIN_ELEMS_PER_BUCKET  1 /* Elems/bucket < 1: reduce # of buckets. */
+#define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
+#define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
+
+/* Number of old buckets moved into the new bucket array by each
+   insertion or deletion while the table is being resized.
+   rehash() only resizes once the load leaves the range from
+   MIN_ELEMS_PER_BUCKET to MAX_ELEMS_PER_BUCKET, and leaves it
+   near BEST_ELEMS_PER_BUCKET, so the element count must change
+   by at least half the number of old buckets before the next
+   resize is due.  Moving 2 at a time therefore always finishes
+   one resize before the next one is needed. */
+#define MOVE_BUCKETS 2
+
 static struct list *find_bucket (struct hash *, struct hash_elem *);
 static struct hash_elem *find_elem (struct hash *, struct list *,
                                     struct hash_elem *);
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
+static size_t best_bucket_cnt (const struct hash *, size_t elem_cnt);
 static void rehash (struct hash *);
+static bool start_resize (struct hash *, size_t new_bucket_cnt);
+static void move_buckets (struct hash *, size_t cnt);
+static struct list *next_bucket (struct hash *, struct list *);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -28,6 +47,10 @@ hash_init (struct hash *h,
   h->elem_cnt = 0;
   h->bucket_cnt = 4;
   h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+  h->move_idx = 0;
+  h->min_bucket_cnt = 4;
   h->hash = hash;
   h->less = less;
   h->aux = aux;
@@ -53,12 +76,10 @@ hash_init (struct hash *h,
 void
 hash_clear (struct hash *h, hash_action_func *destructor) 
 {
-  size_t i;
+  struct list *bucket;
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  for (bucket = h->buckets; bucket != NULL; bucket = next_bucket (h, bucket))
     {
-      struct list *bucket = &h->buckets[i];
-
       if (destructor != NULL) 
         while (!list_empty (bucket)) 
           {
@@ -70,6 +91,11 @@ hash_clear (struct hash *h, hash_action_func *destructor)
       list_init (bucket); 
     }    
 
+  /* Nothing is left to move out of the old buckets. */
+  free (h->old_buckets);
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+
   h->elem_cnt = 0;
 }
 
@@ -89,6 +115,33 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
   if (destructor != NULL)
     hash_clear (h, destructor);
   free (h->buckets);
+  free (h->old_buckets);
+}
+
+/* Resizes hash table H, if necessary, so that ELEM_CNT elements
+   fit at the ideal density, and keeps it from shrinking below
+   that size later.  Unlike the resizing done as elements come
+   and go, this moves every element right away, so it is best
+   called while H is still small, for example right after
+   hash_init().  Returns true if successful, false if memory
+   could not be allocated, in which case H is still usable. */
+bool
+hash_reserve (struct hash *h, size_t elem_cnt)
+{
+  size_t bucket_cnt = 4;
+
+  while (bucket_cnt * BEST_ELEMS_PER_BUCKET < elem_cnt)
+    bucket_cnt *= 2;
+  h->min_bucket_cnt = bucket_cnt;
+
+  move_buckets (h, SIZE_MAX);
+  if (h->bucket_cnt < bucket_cnt)
+    {
+      if (!start_resize (h, bucket_cnt))
+        return false;
+      move_buckets (h, SIZE_MAX);
+    }
+  return true;
 }
 
 /* Inserts NEW into hash table H and returns a null pointer, if
@@ -153,6 +206,48 @@ hash_delete (struct hash *h, struct hash_elem *e)
   return found;
 }
 
+/* Inserts the CNT elements in ELEMS into hash table H, growing H
+   just once beforehand to make room for all of them.  Sets
+   ELEMS[i] to a null pointer if it was inserted, or to the equal
+   element already in the table if it was not, as hash_insert()
+   would return.  Returns the number of elements inserted. */
+size_t
+hash_insert_bulk (struct hash *h, struct hash_elem *elems[], size_t cnt)
+{
+  size_t inserted = 0;
+  size_t bucket_cnt;
+  size_t i;
+
+  ASSERT (elems != NULL || cnt == 0);
+
+  /* Grow straight to the size that the table will want once all
+     of ELEMS are in it. */
+  bucket_cnt = best_bucket_cnt (h, h->elem_cnt + cnt);
+  if (bucket_cnt > h->bucket_cnt)
+    {
+      move_buckets (h, SIZE_MAX);
+      if (start_resize (h, bucket_cnt))
+        move_buckets (h, SIZE_MAX);
+    }
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct list *bucket = find_bucket (h, elems[i]);
+      struct hash_elem *old = find_elem (h, bucket, elems[i]);
+
+      if (old == NULL)
+        {
+          insert_elem (h, bucket, elems[i]);
+          inserted++;
+        }
+      elems[i] = old;
+    }
+
+  rehash (h);
+
+  return inserted;
+}
+
 /* Calls ACTION for each element in hash table H in arbitrary
    order. 
    Modifying hash table H while hash_apply() is running, using
@@ -162,13 +257,12 @@ hash_delete (struct hash *h, struct hash_elem *e)
 void
 hash_apply (struct hash *h, hash_action_func *action) 
 {
-  size_t i;
+  struct list *bucket;
   
   ASSERT (action != NULL);
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  for (bucket = h->buckets; bucket != NULL; bucket = next_bucket (h, bucket))
     {
-      struct list *bucket = &h->buckets[i];
       struct list_elem *elem, *next;
 
       for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) 
@@ -223,7 +317,8 @@ hash_next (struct hash_iterator *i)
   i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
   while (i->elem == list_elem_to_hash_elem (list_end (i->bucket)))
     {
-      if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt)
+      i->bucket = next_bucket (i->hash, i->bucket);
+      if (i->bucket == NULL)
         {
           i->elem = NULL;
           break;
@@ -301,12 +396,38 @@ hash_int (int i)
   return hash_bytes (&i, sizeof i);
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Returns the bucket in H that E belongs in: its bucket in the
+   old bucket array if H is being resized and that bucket has not
+   been moved yet, otherwise its bucket in the current array. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-  return &h->buckets[bucket_idx];
+  unsigned hash = h->hash (e, h->aux);
+
+  if (h->old_buckets != NULL)
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->move_idx)
+        return &h->old_buckets[old_idx];
+    }
+  return &h->buckets[hash & (h->bucket_cnt - 1)];
+}
+
+/* Returns the bucket that follows BUCKET when visiting every
+   bucket in H, first those in the current bucket array and then
+   those not yet moved out of the old one, or a null pointer if
+   BUCKET is the last. */
+static struct list *
+next_bucket (struct hash *h, struct list *bucket)
+{
+  if (bucket >= h->buckets && bucket < h->buckets + h->bucket_cnt)
+    {
+      if (++bucket < h->buckets + h->bucket_cnt)
+        return bucket;
+      return h->old_buckets != NULL ? &h->old_buckets[h->move_idx] : NULL;
+    }
+  else
+    return ++bucket < h->old_buckets + h->old_bucket_cnt ? bucket : NULL;
 }
 
 /* Searches BUCKET in H for a hash element equal to E.  Returns
@@ -339,41 +460,72 @@ is_power_of_2 (size_t x)
   return x != 0 && turn_off_least_1bit (x) == 0;
 }
 
-/* Element per bucket ratios. */
-#define MIN_ELEMS_PER_BUCKET  1 /* Elems/bucket < 1: reduce # of buckets. */
-#define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
-#define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
+/* Returns the number of buckets that hash table H should have
+   to hold ELEM_CNT elements. */
+static size_t
+best_bucket_cnt (const struct hash *h, size_t elem_cnt)
+{
+  size_t bucket_cnt;
+
+  /* We want one bucket for about every BEST_ELEMS_PER_BUCKET.
+     We must have at least min_bucket_cnt buckets, and the
+     number of buckets must be a power of 2. */
+  bucket_cnt = elem_cnt / BEST_ELEMS_PER_BUCKET;
+  if (bucket_cnt < h->min_bucket_cnt)
+    bucket_cnt = h->min_bucket_cnt;
+  while (!is_power_of_2 (bucket_cnt))
+    bucket_cnt = turn_off_least_1bit (bucket_cnt);
+  return bucket_cnt;
+}
 
 /* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+   ideal.  Starts a resize if none is in progress and there are
+   more than MAX_ELEMS_PER_BUCKET or fewer than
+   MIN_ELEMS_PER_BUCKET elements per bucket, then moves a few
+   more old buckets into place.
+   This function can fail because of an out-of-memory condition,
+   but that'll just make hash accesses less efficient; we can
+   still continue. */
 static void
 rehash (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
-  size_t i;
-
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
-
-  /* Calculate the number of buckets to use now.
-     We want one bucket for about every BEST_ELEMS_PER_BUCKET.
-     We must have at least four buckets, and the number of
-     buckets must be a power of 2. */
-  new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
-  if (new_bucket_cnt < 4)
-    new_bucket_cnt = 4;
-  while (!is_power_of_2 (new_bucket_cnt))
-    new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
-
-  /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
-    return;
+  if (h->old_buckets == NULL)
+    {
+      size_t new_bucket_cnt;
+
+      /* Grow to the ideal size, but only halve when shrinking:
+         the ideal size for a table just below the threshold
+         would leave it just below the threshold for growing. */
+      if (h->elem_cnt > h->bucket_cnt * MAX_ELEMS_PER_BUCKET)
+        new_bucket_cnt = best_bucket_cnt (h, h->elem_cnt);
+      else if (h->elem_cnt < h->bucket_cnt * MIN_ELEMS_PER_BUCKET
+               && h->bucket_cnt > h->min_bucket_cnt)
+        new_bucket_cnt = h->bucket_cnt / 2;
+      else
+        return;
+
+      if (!start_resize (h, new_bucket_cnt))
+        return;
+    }
+
+  move_buckets (h, MOVE_BUCKETS);
+}
+
+/* Makes H's buckets the old buckets and installs a new, empty
+   array of NEW_BUCKET_CNT buckets, into which move_buckets()
+   will then move the old buckets' elements.  H must not already
+   be in the middle of a resize.  Returns true if successful,
+   false if memory could not be allocated. */
+static bool
+start_resize (struct hash *h, size_t new_bucket_cnt)
+{
+  struct list *new_buckets;
+  size_t i;
+
+  ASSERT (h->old_buckets == NULL);
+  ASSERT (is_power_of_2 (new_bucket_cnt));
 
   /* Allocate new buckets and initialize them as empty. */
   new_buckets = malloc (sizeof *new_buckets * new_bucket_cnt);
@@ -382,34 +534,49 @@ rehash (struct hash *h)
       /* Allocation failed.  This means that use of the hash table will
          be less efficient.  However, it is still usable, so
          there's no reason for it to be an error. */
-      return;
+      return false;
     }
   for (i = 0; i < new_bucket_cnt; i++) 
     list_init (&new_buckets[i]);
 
   /* Install new bucket info. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->move_idx = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
+  return true;
+}
+
+/* Moves the elements of up to CNT old buckets in H into the
+   appropriate new buckets.  Frees the old bucket array once it
+   is empty, which ends the resize.  Does nothing if H is not
+   being resized. */
+static void
+move_buckets (struct hash *h, size_t cnt)
+{
+  if (h->old_buckets == NULL)
+    return;
 
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
+  for (; cnt > 0 && h->move_idx < h->old_bucket_cnt; cnt--)
     {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
+      struct list *old_bucket = &h->old_buckets[h->move_idx++];
 
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
+      while (!list_empty (old_bucket))
         {
-          struct list *new_bucket
-            = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
-          list_push_front (new_bucket, elem);
+          struct list_elem *elem = list_pop_front (old_bucket);
+          unsigned hash = h->hash (list_elem_to_hash_elem (elem), h->aux);
+          list_push_front (&h->buckets[hash & (h->bucket_cnt - 1)], elem);
         }
     }
 
-  free (old_buckets);
+  if (h->move_idx >= h->old_bucket_cnt)
+    {
+      free (h->old_buckets);
+      h->old_buckets = NULL;
+      h->old_bucket_cnt = 0;
+      h->move_idx = 0;
+    }
 }
 
 /* Inserts E into BUCKET (in hash table H). */
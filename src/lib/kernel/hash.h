@@ -18,7 +18,18 @@
    conversion from a struct hash_elem back to a structure object
    that contains it.  This is the same technique used in the
    linked list implementation.  Refer to lib/kernel/list.h for a
-   detailed explanation. */
+   detailed explanation.
+
+   The table grows and shrinks with the number of elements, but
+   it never rehashes everything at once.  Resizing allocates the
+   new bucket array and then moves just a couple of old buckets
+   per insertion or deletion, so no single operation pays for
+   moving the whole table.  Until the old buckets have all been
+   moved, each element lives in exactly one of the two arrays: in
+   its old bucket if that bucket has not been moved yet, in its
+   new bucket otherwise.  A caller that knows how big a table
+   will get can size it up front with hash_reserve(), or insert
+   many elements at once with hash_insert_bulk(). */
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -61,6 +72,10 @@ struct hash
     size_t elem_cnt;            /* Number of elements in table. */
     size_t bucket_cnt;          /* Number of buckets, a power of 2. */
     struct list *buckets;       /* Array of `bucket_cnt' lists. */
+    struct list *old_buckets;   /* Buckets being moved out, or null. */
+    size_t old_bucket_cnt;      /* Number of buckets in `old_buckets'. */
+    size_t move_idx;            /* Next old bucket to move. */
+    size_t min_bucket_cnt;      /* Never shrink below this many buckets. */
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
@@ -78,12 +93,14 @@ struct hash_iterator
 bool hash_init (struct hash *, hash_hash_func *, hash_less_func *, void *aux);
 void hash_clear (struct hash *, hash_action_func *);
 void hash_destroy (struct hash *, hash_action_func *);
+bool hash_reserve (struct hash *, size_t elem_cnt);
 
 /* Search, insertion, deletion. */
 struct hash_elem *hash_insert (struct hash *, struct hash_elem *);
 struct hash_elem *hash_replace (struct hash *, struct hash_elem *);
 struct hash_elem *hash_find (struct hash *, struct hash_elem *);
 struct hash_elem *hash_delete (struct hash *, struct hash_elem *);
+size_t hash_insert_bulk (struct hash *, struct hash_elem *elems[], size_t cnt);
 
 /* Iteration. */
 void hash_apply (struct hash *, hash_action_func *);
@@ -0,0 +1,401 @@
+/* Open-addressing hash map.
+
+   See hashmap.h for basic information. */
+
+#include "hashmap.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Number of slots in a new map. */
+#define MIN_SLOT_CNT 8
+
+/* The map grows once more than MAX_LOAD_NUM / MAX_LOAD_DEN of its
+   slots are in use.  Robin Hood probing keeps lookups short well
+   beyond this load, but this leaves room for misses to stop
+   early at an empty slot. */
+#define MAX_LOAD_NUM 3
+#define MAX_LOAD_DEN 4
+
+static struct hashmap_slot *find_slot (const struct hashmap *,
+                                       uintptr_t key, unsigned hash);
+static void place (struct hashmap *, uintptr_t key, void *value,
+                   unsigned hash);
+static bool resize (struct hashmap *, size_t new_slot_cnt);
+
+/* Initializes hash map M to compute hash values using HASH and
+   compare keys using LESS, given auxiliary data AUX.  Returns
+   true if successful, false if memory could not be allocated.
+   If this fails, M is still an empty map with no slots, which
+   tries again to allocate slots on the first insertion.  A hash
+   map whose bytes are all zero may only be passed to
+   hashmap_destroy(). */
+bool
+hashmap_init (struct hashmap *m,
+              hashmap_hash_func *hash, hashmap_less_func *less, void *aux)
+{
+  ASSERT (m != NULL);
+  ASSERT (hash != NULL);
+  ASSERT (less != NULL);
+
+  m->elem_cnt = 0;
+  m->slot_cnt = MIN_SLOT_CNT;
+  m->slots = calloc (m->slot_cnt, sizeof *m->slots);
+  m->hash = hash;
+  m->less = less;
+  m->aux = aux;
+  if (m->slots == NULL)
+    {
+      m->slot_cnt = 0;
+      return false;
+    }
+  return true;
+}
+
+/* Removes all the elements from M, keeping its slot array.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the map.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the element's key or value.  However, modifying
+   hash map M while hashmap_clear() is running, using any of the
+   functions hashmap_clear(), hashmap_destroy(),
+   hashmap_reserve(), hashmap_insert(), or hashmap_delete(),
+   yields undefined behavior, whether done in DESTRUCTOR or
+   elsewhere. */
+void
+hashmap_clear (struct hashmap *m, hashmap_action_func *destructor)
+{
+  size_t i;
+
+  for (i = 0; i < m->slot_cnt; i++)
+    {
+      struct hashmap_slot *s = &m->slots[i];
+
+      if (s->value != NULL && destructor != NULL)
+        destructor (s->key, s->value, m->aux);
+      s->value = NULL;
+    }
+  m->elem_cnt = 0;
+}
+
+/* Destroys hash map M.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the map, with the same restrictions as for
+   hashmap_clear(). */
+void
+hashmap_destroy (struct hashmap *m, hashmap_action_func *destructor)
+{
+  if (destructor != NULL)
+    hashmap_clear (m, destructor);
+  free (m->slots);
+}
+
+/* Grows M, if necessary, so that it can hold ELEM_CNT elements
+   without growing again.  Returns true if successful, false if
+   memory could not be allocated, in which case M is unchanged. */
+bool
+hashmap_reserve (struct hashmap *m, size_t elem_cnt)
+{
+  size_t slot_cnt = m->slot_cnt > 0 ? m->slot_cnt : MIN_SLOT_CNT;
+
+  while (slot_cnt * MAX_LOAD_NUM < elem_cnt * MAX_LOAD_DEN)
+    slot_cnt *= 2;
+  return slot_cnt == m->slot_cnt || resize (m, slot_cnt);
+}
+
+/* Inserts KEY into hash map M with the given VALUE, which must
+   not be null.  Returns true if successful, false if a key equal
+   to KEY is already in M (in which case M is unchanged) or if M
+   had to grow but memory could not be allocated. */
+bool
+hashmap_insert (struct hashmap *m, uintptr_t key, void *value)
+{
+  unsigned hash = m->hash (key, m->aux);
+
+  ASSERT (value != NULL);
+
+  if (find_slot (m, key, hash) != NULL)
+    return false;
+
+  /* Grow if the map is getting full.  If that fails, keep going
+     as long as at least one slot stays empty, because lookups
+     rely on reaching an empty slot to stop. */
+  if ((m->elem_cnt + 1) * MAX_LOAD_DEN > m->slot_cnt * MAX_LOAD_NUM
+      && !resize (m, m->slot_cnt > 0 ? m->slot_cnt * 2 : MIN_SLOT_CNT)
+      && m->elem_cnt + 1 >= m->slot_cnt)
+    return false;
+
+  place (m, key, value, hash);
+  m->elem_cnt++;
+  return true;
+}
+
+/* Returns the value of the element in hash map M whose key is
+   equal to KEY, or a null pointer if there is none. */
+void *
+hashmap_find (const struct hashmap *m, uintptr_t key)
+{
+  struct hashmap_slot *s = find_slot (m, key, m->hash (key, m->aux));
+  return s != NULL ? s->value : NULL;
+}
+
+/* Removes the element whose key is equal to KEY from hash map M
+   and returns its value.  Returns a null pointer if there was no
+   such element.
+
+   If the element's key or value is dynamically allocated, or
+   owns resources that are, then it is the caller's
+   responsibility to deallocate them. */
+void *
+hashmap_delete (struct hashmap *m, uintptr_t key)
+{
+  struct hashmap_slot *s = find_slot (m, key, m->hash (key, m->aux));
+  size_t mask = m->slot_cnt - 1;
+  size_t idx;
+  void *value;
+
+  if (s == NULL)
+    return NULL;
+  value = s->value;
+
+  /* Shift each following element that is not in its home slot
+     back by one, until reaching an empty slot or an element
+     that is already home. */
+  for (idx = s - m->slots; ; idx = (idx + 1) & mask)
+    {
+      struct hashmap_slot *next = &m->slots[(idx + 1) & mask];
+
+      if (next->value == NULL || (next->hash & mask) == ((idx + 1) & mask))
+        break;
+      m->slots[idx] = *next;
+    }
+  m->slots[idx].value = NULL;
+  m->elem_cnt--;
+
+  return value;
+}
+
+/* Calls ACTION for each element in hash map M in arbitrary
+   order.
+   Modifying hash map M while hashmap_apply() is running, using
+   any of the functions hashmap_clear(), hashmap_destroy(),
+   hashmap_reserve(), hashmap_insert(), or hashmap_delete(),
+   yields undefined behavior, whether done from ACTION or
+   elsewhere. */
+void
+hashmap_apply (struct hashmap *m, hashmap_action_func *action)
+{
+  size_t i;
+
+  ASSERT (action != NULL);
+
+  for (i = 0; i < m->slot_cnt; i++)
+    if (m->slots[i].value != NULL)
+      action (m->slots[i].key, m->slots[i].value, m->aux);
+}
+
+/* Initializes I for iterating hash map M.
+
+   Iteration idiom:
+
+      struct hashmap_iterator i;
+
+      hashmap_first (&i, m);
+      while (hashmap_next (&i))
+        {
+          struct foo *f = hashmap_cur_value (&i);
+          ...do something with f...
+        }
+
+   Modifying hash map M during iteration, using any of the
+   functions hashmap_clear(), hashmap_destroy(),
+   hashmap_reserve(), hashmap_insert(), or hashmap_delete(),
+   invalidates all iterators. */
+void
+hashmap_first (struct hashmap_iterator *i, struct hashmap *m)
+{
+  ASSERT (i != NULL);
+  ASSERT (m != NULL);
+
+  i->map = m;
+  i->slot = NULL;
+}
+
+/* Advances I to the next element in the hash map.  Returns true
+   if there is one, false if no elements are left.  Elements are
+   visited in arbitrary order. */
+bool
+hashmap_next (struct hashmap_iterator *i)
+{
+  struct hashmap_slot *end;
+
+  ASSERT (i != NULL);
+
+  end = i->map->slots + i->map->slot_cnt;
+  i->slot = i->slot != NULL ? i->slot + 1 : i->map->slots;
+  while (i->slot < end && i->slot->value == NULL)
+    i->slot++;
+  return i->slot < end;
+}
+
+/* Returns the key of the current element in the iteration.
+   Undefined behavior unless the last call to hashmap_next()
+   returned true. */
+uintptr_t
+hashmap_cur_key (const struct hashmap_iterator *i)
+{
+  return i->slot->key;
+}
+
+/* Returns the value of the current element in the iteration.
+   Undefined behavior unless the last call to hashmap_next()
+   returned true. */
+void *
+hashmap_cur_value (const struct hashmap_iterator *i)
+{
+  return i->slot->value;
+}
+
+/* Returns the number of elements in M. */
+size_t
+hashmap_size (const struct hashmap *m)
+{
+  return m->elem_cnt;
+}
+
+/* Returns true if M contains no elements, false otherwise. */
+bool
+hashmap_empty (const struct hashmap *m)
+{
+  return m->elem_cnt == 0;
+}
+
+/* Returns a hash of integer KEY.  Every bit of KEY affects the
+   low-order bits of the result, which are the ones used to pick
+   a slot, so keys that differ only in their high bits, such as
+   page-aligned addresses, still spread out. */
+unsigned
+hashmap_hash_uint (uintptr_t key, void *aux UNUSED)
+{
+  /* Finalization step of MurmurHash3. */
+  unsigned h = key;
+
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+/* Returns true if integer A is less than integer B. */
+bool
+hashmap_less_uint (uintptr_t a, uintptr_t b, void *aux UNUSED)
+{
+  return a < b;
+}
+
+/* Returns the distance of the element in slot IDX of M from its
+   home slot, the slot its hash selects. */
+static inline size_t
+probe_dist (const struct hashmap *m, size_t idx)
+{
+  return (idx - m->slots[idx].hash) & (m->slot_cnt - 1);
+}
+
+/* Returns the slot in M that holds a key equal to KEY, whose
+   hash is HASH, or a null pointer if there is none. */
+static struct hashmap_slot *
+find_slot (const struct hashmap *m, uintptr_t key, unsigned hash)
+{
+  size_t mask = m->slot_cnt - 1;
+  size_t idx = hash & mask;
+  size_t dist;
+
+  /* A map whose slot array could not be allocated is empty. */
+  if (m->slot_cnt == 0)
+    return NULL;
+
+  /* Robin Hood insertion keeps the elements along a probe
+     sequence ordered by distance from home, so once we reach an
+     element closer to its home than KEY would be, KEY cannot be
+     further along. */
+  for (dist = 0; ; dist++, idx = (idx + 1) & mask)
+    {
+      struct hashmap_slot *s = &m->slots[idx];
+
+      if (s->value == NULL || probe_dist (m, idx) < dist)
+        return NULL;
+      if (s->hash == hash
+          && !m->less (s->key, key, m->aux) && !m->less (key, s->key, m->aux))
+        return s;
+    }
+}
+
+/* Places KEY, with VALUE and HASH, into M, which must not
+   already contain KEY and must have at least one empty slot. */
+static void
+place (struct hashmap *m, uintptr_t key, void *value, unsigned hash)
+{
+  size_t mask = m->slot_cnt - 1;
+  size_t idx = hash & mask;
+  size_t dist;
+
+  for (dist = 0; ; dist++, idx = (idx + 1) & mask)
+    {
+      struct hashmap_slot *s = &m->slots[idx];
+      struct hashmap_slot displaced;
+      size_t s_dist;
+
+      if (s->value == NULL)
+        {
+          s->key = key;
+          s->value = value;
+          s->hash = hash;
+          return;
+        }
+
+      /* Take the slot from an element that is closer to home,
+         then carry on placing that element instead. */
+      s_dist = probe_dist (m, idx);
+      if (s_dist < dist)
+        {
+          displaced = *s;
+          s->key = key;
+          s->value = value;
+          s->hash = hash;
+          key = displaced.key;
+          value = displaced.value;
+          hash = displaced.hash;
+          dist = s_dist;
+        }
+    }
+}
+
+/* Moves the elements of M into a new array of NEW_SLOT_CNT
+   slots, which must be a power of 2 large enough to hold them.
+   Returns true if successful, false if memory could not be
+   allocated, in which case M is unchanged. */
+static bool
+resize (struct hashmap *m, size_t new_slot_cnt)
+{
+  struct hashmap_slot *old_slots = m->slots;
+  size_t old_slot_cnt = m->slot_cnt;
+  struct hashmap_slot *new_slots;
+  size_t i;
+
+  ASSERT (new_slot_cnt > m->elem_cnt);
+  ASSERT ((new_slot_cnt & (new_slot_cnt - 1)) == 0);
+
+  new_slots = calloc (new_slot_cnt, sizeof *new_slots);
+  if (new_slots == NULL)
+    return false;
+
+  m->slots = new_slots;
+  m->slot_cnt = new_slot_cnt;
+  for (i = 0; i < old_slot_cnt; i++)
+    if (old_slots[i].value != NULL)
+      place (m, old_slots[i].key, old_slots[i].value, old_slots[i].hash);
+  free (old_slots);
+  return true;
+}
@@ -0,0 +1,104 @@
+#ifndef __LIB_KERNEL_HASHMAP_H
+#define __LIB_KERNEL_HASHMAP_H
+
+/* Open-addressing hash map.
+
+   Maps keys to values, like a struct hash (see hash.h) whose
+   elements consist of just a key and a pointer.  Instead of
+   chaining elements embedded in other structures through
+   per-bucket lists, a hash map keeps each key, its value, and
+   its hash in a single flat array of slots, so a lookup usually
+   touches one or two adjacent slots instead of following
+   pointers across memory.  That makes it a good fit for hot
+   lookup tables whose keys are small: sector numbers, user
+   virtual addresses, thread identifiers, and the like.
+
+   Keys are uintptr_t, so they may be integers or pointers.
+   Values are pointers and must not be null.  Like struct hash,
+   the map is parameterized by a hash function and a comparison
+   function over keys; two keys are equal if neither is less
+   than the other.
+
+   Collisions are resolved by linear probing with "Robin Hood"
+   insertion: an element being inserted takes the slot of any
+   element it passes that is closer to its own home slot,
+   keeping the probe sequences for all keys short.  Deletion
+   shifts the following elements back instead of leaving
+   tombstones.  The map doubles in size when it becomes 3/4
+   full.
+
+   A hash map allocates its slot array with malloc(), so it can
+   only be used after the kernel's memory allocator has been
+   initialized. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Computes and returns the hash value for KEY, given auxiliary
+   data AUX. */
+typedef unsigned hashmap_hash_func (uintptr_t key, void *aux);
+
+/* Compares keys A and B, given auxiliary data AUX.  Returns true
+   if A is less than B, or false if A is greater than or equal to
+   B. */
+typedef bool hashmap_less_func (uintptr_t a, uintptr_t b, void *aux);
+
+/* Performs some operation on the element with the given KEY and
+   VALUE, given auxiliary data AUX. */
+typedef void hashmap_action_func (uintptr_t key, void *value, void *aux);
+
+/* Hash map slot. */
+struct hashmap_slot
+  {
+    uintptr_t key;              /* Key. */
+    void *value;                /* Value, or null if slot is empty. */
+    unsigned hash;              /* Hash of `key'. */
+  };
+
+/* Hash map. */
+struct hashmap
+  {
+    size_t elem_cnt;            /* Number of elements in map. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct hashmap_slot *slots; /* Array of `slot_cnt' slots. */
+    hashmap_hash_func *hash;    /* Hash function. */
+    hashmap_less_func *less;    /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `hash' and `less'. */
+  };
+
+/* A hash map iterator. */
+struct hashmap_iterator
+  {
+    struct hashmap *map;        /* The hash map. */
+    struct hashmap_slot *slot;  /* Current slot. */
+  };
+
+/* Basic life cycle. */
+bool hashmap_init (struct hashmap *, hashmap_hash_func *, hashmap_less_func *,
+                   void *aux);
+void hashmap_clear (struct hashmap *, hashmap_action_func *);
+void hashmap_destroy (struct hashmap *, hashmap_action_func *);
+bool hashmap_reserve (struct hashmap *, size_t elem_cnt);
+
+/* Search, insertion, deletion. */
+bool hashmap_insert (struct hashmap *, uintptr_t key, void *value);
+void *hashmap_find (const struct hashmap *, uintptr_t key);
+void *hashmap_delete (struct hashmap *, uintptr_t key);
+
+/* Iteration. */
+void hashmap_apply (struct hashmap *, hashmap_action_func *);
+void hashmap_first (struct hashmap_iterator *, struct hashmap *);
+bool hashmap_next (struct hashmap_iterator *);
+uintptr_t hashmap_cur_key (const struct hashmap_iterator *);
+void *hashmap_cur_value (const struct hashmap_iterator *);
+
+/* Information. */
+size_t hashmap_size (const struct hashmap *);
+bool hashmap_empty (const struct hashmap *);
+
+/* Sample key functions. */
+unsigned hashmap_hash_uint (uintptr_t key, void *aux);
+bool hashmap_less_uint (uintptr_t a, uintptr_t b, void *aux);
+
+#endif /* lib/kernel/hashmap.h */
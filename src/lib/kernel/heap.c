@@ -0,0 +1,227 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a heap-ordered multiway tree.  Each element
+   points to its leftmost child and to its next sibling, so the
+   children of an element form a singly linked list.  To allow
+   arbitrary elements to be cut out of the tree in constant time,
+   each element also points back to its previous sibling, or to
+   its parent if it is the leftmost child.  The root has no
+   siblings, so its `next' and `prev' are both null.
+
+   Two heap-ordered trees are combined ("melded") by making the
+   tree with the greater root the leftmost child of the other.
+   Removing the root leaves its list of children, which are
+   melded back into a single tree in two passes: first pairwise
+   from left to right, then from right to left, accumulating into
+   one tree.  This second step is what gives the pairing heap its
+   O(lg n) amortized bound. */
+
+static struct heap_elem *meld (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux)
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->elem_cnt = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->next = elem->prev = NULL;
+  heap->root = heap->root != NULL ? meld (heap, heap->root, elem) : elem;
+  heap->elem_cnt++;
+}
+
+/* Returns the element at the top of HEAP.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_top (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+  ASSERT (heap->root != NULL);
+
+  return heap->root;
+}
+
+/* Removes the element at the top of HEAP and returns it.
+   Undefined behavior if HEAP is empty before removal. */
+struct heap_elem *
+heap_pop (struct heap *heap)
+{
+  struct heap_elem *top = heap_top (heap);
+
+  heap->root = merge_pairs (heap, top->child);
+  heap->elem_cnt--;
+  top->child = NULL;
+  return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem)
+{
+  struct heap_elem *subtree;
+
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem == heap->root)
+    {
+      heap_pop (heap);
+      return;
+    }
+
+  cut (elem);
+  subtree = merge_pairs (heap, elem->child);
+  if (subtree != NULL)
+    heap->root = meld (heap, heap->root, subtree);
+  heap->elem_cnt--;
+  elem->child = NULL;
+}
+
+/* Restores HEAP's ordering after the key of ELEM, which must be
+   in HEAP, moved toward the top of the heap, e.g. after the
+   wakeup time of an element in a min-heap became earlier or the
+   priority of an element in a max-heap rose. */
+void
+heap_decrease (struct heap *heap, struct heap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem == heap->root)
+    return;
+
+  /* ELEM's subtree is still heap-ordered, so it can be cut out
+     and melded back in as a whole. */
+  cut (elem);
+  heap->root = meld (heap, heap->root, elem);
+}
+
+/* Restores HEAP's ordering after the key of ELEM, which must be
+   in HEAP, changed in either direction. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem)
+{
+  heap_remove (heap, elem);
+  heap_push (heap, elem);
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->elem_cnt;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->root == NULL;
+}
+
+/* Melds the trees rooted at A and B, neither of which may have
+   siblings, and returns the root of the combined tree. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b)
+{
+  if (heap->less (b, a, heap->aux))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the leftmost child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  a->next = a->prev = NULL;
+  return a;
+}
+
+/* Melds FIRST and all of its following siblings into a single
+   tree and returns its root, or a null pointer if FIRST is
+   null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root;
+
+  /* First pass: meld siblings pairwise from left to right,
+     pushing each result onto PAIRS, which is linked through
+     `next' and so ends up in right-to-left order. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+      struct heap_elem *m;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        {
+          b->next = b->prev = NULL;
+          m = meld (heap, a, b);
+        }
+      else
+        m = a;
+      m->next = pairs;
+      pairs = m;
+    }
+
+  /* Second pass: meld the pairs from right to left. */
+  if (pairs == NULL)
+    return NULL;
+  root = pairs;
+  pairs = pairs->next;
+  root->next = NULL;
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->next;
+      pairs->next = NULL;
+      root = meld (heap, root, pairs);
+      pairs = next;
+    }
+  return root;
+}
+
+/* Detaches the subtree rooted at ELEM, which must not be a root,
+   from its parent and siblings. */
+static void
+cut (struct heap_elem *elem)
+{
+  ASSERT (elem->prev != NULL);
+
+  if (elem->prev->child == elem)
+    elem->prev->child = elem->next;
+  else
+    elem->prev->next = elem->next;
+  if (elem->next != NULL)
+    elem->next->prev = elem->prev;
+  elem->next = elem->prev = NULL;
+}
@@ -0,0 +1,86 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+
+   This is a pairing heap.  Like the linked list in list.h, it
+   does not require use of dynamically allocated memory.
+   Instead, each structure that can potentially be in a heap must
+   embed a struct heap_elem member.  All of the heap functions
+   operate on these `struct heap_elem's.  The heap_entry macro
+   allows conversion from a struct heap_elem back to a structure
+   object that contains it.  Refer to lib/kernel/list.h for a
+   detailed explanation of this technique.
+
+   The heap is ordered by a caller-supplied comparison function.
+   The "top" of the heap is an element that is not greater than
+   any other element, so a heap whose comparison function returns
+   true when A's key is less than B's is a min-heap and one whose
+   comparison function returns true when A's key is greater than
+   B's is a max-heap.
+
+   Costs, where n is the number of elements in the heap:
+
+     - heap_push(), heap_top(), heap_decrease(): O(1).
+
+     - heap_pop(), heap_remove(), heap_update(): O(lg n)
+       amortized.
+
+   An element's key may change only while it is not in a heap or
+   immediately before a call to heap_decrease() or heap_update()
+   on that element. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *child;    /* Leftmost child. */
+    struct heap_elem *next;     /* Next sibling. */
+    struct heap_elem *prev;     /* Previous sibling, or parent if
+                                   this is the leftmost child. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A should be nearer the
+   top of the heap than B, false otherwise. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Top element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in heap. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Heap insertion and removal. */
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (const struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+/* Key changes. */
+void heap_decrease (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+/* Heap properties. */
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
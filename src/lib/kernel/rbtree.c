@@ -0,0 +1,470 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* A red-black tree is a binary search tree that satisfies these
+   properties, where null children count as black leaves:
+
+     1. The root is black.
+
+     2. A red element has no red children.
+
+     3. Every path from an element down to a leaf passes through
+        the same number of black elements.
+
+   Together these keep the longest path from the root no more
+   than twice as long as the shortest, so the tree's height is
+   O(lg n).  Insertion and removal first modify the tree as in
+   an ordinary binary search tree, then walk back up restoring
+   the properties with recolorings and at most three rotations.
+   See Cormen, Leiserson, Rivest, and Stein, "Introduction to
+   Algorithms", chapter 13. */
+
+static void rotate_left (struct rbtree *, struct rbtree_elem *);
+static void rotate_right (struct rbtree *, struct rbtree_elem *);
+static void transplant (struct rbtree *, struct rbtree_elem *,
+                        struct rbtree_elem *);
+static void insert_fixup (struct rbtree *, struct rbtree_elem *);
+static void remove_fixup (struct rbtree *, struct rbtree_elem *,
+                          struct rbtree_elem *);
+
+/* Initializes TREE as an empty tree ordered by LESS given
+   auxiliary data AUX. */
+void
+rbtree_init (struct rbtree *tree, rbtree_less_func *less, void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->elem_cnt = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Inserts ELEM into TREE and returns a null pointer, if no equal
+   element is already in the tree.
+   If an equal element is already in the tree, returns it
+   without inserting ELEM. */
+struct rbtree_elem *
+rbtree_insert (struct rbtree *tree, struct rbtree_elem *elem)
+{
+  struct rbtree_elem *parent = NULL;
+  struct rbtree_elem **link = &tree->root;
+
+  ASSERT (tree != NULL);
+  ASSERT (elem != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (tree->less (elem, parent, tree->aux))
+        link = &parent->left;
+      else if (tree->less (parent, elem, tree->aux))
+        link = &parent->right;
+      else
+        return parent;
+    }
+
+  elem->parent = parent;
+  elem->left = elem->right = NULL;
+  elem->red = true;
+  *link = elem;
+  tree->elem_cnt++;
+
+  insert_fixup (tree, elem);
+  return NULL;
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+rbtree_remove (struct rbtree *tree, struct rbtree_elem *elem)
+{
+  struct rbtree_elem *child, *child_parent;
+  bool removed_red;
+
+  ASSERT (tree != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem->left == NULL || elem->right == NULL)
+    {
+      /* ELEM has at most one child, which takes its place. */
+      child = elem->left != NULL ? elem->left : elem->right;
+      child_parent = elem->parent;
+      removed_red = elem->red;
+      transplant (tree, elem, child);
+    }
+  else
+    {
+      /* ELEM's successor, which has no left child, takes its
+         place and color, so the successor's old position is
+         the one that loses an element. */
+      struct rbtree_elem *next = elem->right;
+
+      while (next->left != NULL)
+        next = next->left;
+      removed_red = next->red;
+      child = next->right;
+      if (next->parent == elem)
+        child_parent = next;
+      else
+        {
+          child_parent = next->parent;
+          transplant (tree, next, child);
+          next->right = elem->right;
+          next->right->parent = next;
+        }
+      transplant (tree, elem, next);
+      next->left = elem->left;
+      next->left->parent = next;
+      next->red = elem->red;
+    }
+  tree->elem_cnt--;
+
+  /* Removing a black element shortens the paths through it. */
+  if (!removed_red)
+    remove_fixup (tree, child, child_parent);
+}
+
+/* Finds and returns an element equal to KEY in TREE, or a null
+   pointer if no equal element exists in the tree. */
+struct rbtree_elem *
+rbtree_find (const struct rbtree *tree, const struct rbtree_elem *key)
+{
+  struct rbtree_elem *e = tree->root;
+
+  while (e != NULL)
+    {
+      if (tree->less (key, e, tree->aux))
+        e = e->left;
+      else if (tree->less (e, key, tree->aux))
+        e = e->right;
+      else
+        break;
+    }
+  return e;
+}
+
+/* Returns the least element in TREE, or a null pointer if TREE
+   is empty. */
+struct rbtree_elem *
+rbtree_first (const struct rbtree *tree)
+{
+  struct rbtree_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->left != NULL)
+      e = e->left;
+  return e;
+}
+
+/* Returns the greatest element in TREE, or a null pointer if
+   TREE is empty. */
+struct rbtree_elem *
+rbtree_last (const struct rbtree *tree)
+{
+  struct rbtree_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->right != NULL)
+      e = e->right;
+  return e;
+}
+
+/* Returns the element that follows ELEM in its tree, or a null
+   pointer if ELEM is the greatest element. */
+struct rbtree_elem *
+rbtree_next (const struct rbtree_elem *elem)
+{
+  ASSERT (elem != NULL);
+
+  if (elem->right != NULL)
+    {
+      elem = elem->right;
+      while (elem->left != NULL)
+        elem = elem->left;
+      return (struct rbtree_elem *) elem;
+    }
+  while (elem->parent != NULL && elem == elem->parent->right)
+    elem = elem->parent;
+  return elem->parent;
+}
+
+/* Returns the element that precedes ELEM in its tree, or a null
+   pointer if ELEM is the least element. */
+struct rbtree_elem *
+rbtree_prev (const struct rbtree_elem *elem)
+{
+  ASSERT (elem != NULL);
+
+  if (elem->left != NULL)
+    {
+      elem = elem->left;
+      while (elem->right != NULL)
+        elem = elem->right;
+      return (struct rbtree_elem *) elem;
+    }
+  while (elem->parent != NULL && elem == elem->parent->left)
+    elem = elem->parent;
+  return elem->parent;
+}
+
+/* Returns the least element in TREE that is not less than KEY,
+   or a null pointer if there is none. */
+struct rbtree_elem *
+rbtree_lower_bound (const struct rbtree *tree,
+                    const struct rbtree_elem *key)
+{
+  struct rbtree_elem *e = tree->root;
+  struct rbtree_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (e, key, tree->aux))
+      e = e->right;
+    else
+      {
+        bound = e;
+        e = e->left;
+      }
+  return bound;
+}
+
+/* Returns the least element in TREE that is greater than KEY, or
+   a null pointer if there is none. */
+struct rbtree_elem *
+rbtree_upper_bound (const struct rbtree *tree,
+                    const struct rbtree_elem *key)
+{
+  struct rbtree_elem *e = tree->root;
+  struct rbtree_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (key, e, tree->aux))
+      {
+        bound = e;
+        e = e->left;
+      }
+    else
+      e = e->right;
+  return bound;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rbtree_size (const struct rbtree *tree)
+{
+  ASSERT (tree != NULL);
+
+  return tree->elem_cnt;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rbtree_empty (const struct rbtree *tree)
+{
+  ASSERT (tree != NULL);
+
+  return tree->root == NULL;
+}
+
+/* Returns true if E is red, false if it is black or null. */
+static inline bool
+is_red (const struct rbtree_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Replaces the subtree rooted at OLD in TREE by the one rooted
+   at NEW, which may be null.  Leaves OLD's own links alone. */
+static void
+transplant (struct rbtree *tree, struct rbtree_elem *old,
+            struct rbtree_elem *new)
+{
+  if (old->parent == NULL)
+    tree->root = new;
+  else if (old == old->parent->left)
+    old->parent->left = new;
+  else
+    old->parent->right = new;
+  if (new != NULL)
+    new->parent = old->parent;
+}
+
+/* Rotates E's right child up into E's place in TREE, making E
+   its left child. */
+static void
+rotate_left (struct rbtree *tree, struct rbtree_elem *e)
+{
+  struct rbtree_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  transplant (tree, e, r);
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates E's left child up into E's place in TREE, making E
+   its right child. */
+static void
+rotate_right (struct rbtree *tree, struct rbtree_elem *e)
+{
+  struct rbtree_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  transplant (tree, e, l);
+  l->right = e;
+  e->parent = l;
+}
+
+/* Restores the red-black properties of TREE after E was
+   inserted as a red leaf, which may have given a red parent a
+   red child. */
+static void
+insert_fixup (struct rbtree *tree, struct rbtree_elem *e)
+{
+  struct rbtree_elem *parent;
+
+  while ((parent = e->parent) != NULL && parent->red)
+    {
+      /* A red parent is not the root, so E has a grandparent. */
+      struct rbtree_elem *grandparent = parent->parent;
+
+      if (parent == grandparent->left)
+        {
+          struct rbtree_elem *uncle = grandparent->right;
+
+          if (is_red (uncle))
+            {
+              /* Push the grandparent's blackness down a level and
+                 continue from the grandparent. */
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+            }
+          else
+            {
+              if (e == parent->right)
+                {
+                  rotate_left (tree, parent);
+                  e = parent;
+                  parent = e->parent;
+                }
+              parent->red = false;
+              grandparent->red = true;
+              rotate_right (tree, grandparent);
+            }
+        }
+      else
+        {
+          struct rbtree_elem *uncle = grandparent->left;
+
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+            }
+          else
+            {
+              if (e == parent->left)
+                {
+                  rotate_right (tree, parent);
+                  e = parent;
+                  parent = e->parent;
+                }
+              parent->red = false;
+              grandparent->red = true;
+              rotate_left (tree, grandparent);
+            }
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black properties of TREE after a black
+   element was removed from above E, a child of PARENT, leaving
+   paths through E one black element short.  E may be null. */
+static void
+remove_fixup (struct rbtree *tree, struct rbtree_elem *e,
+              struct rbtree_elem *parent)
+{
+  while (e != tree->root && !is_red (e))
+    {
+      /* E's sibling cannot be null, because paths through it
+         have at least one more black element than those through
+         E. */
+      if (e == parent->left)
+        {
+          struct rbtree_elem *sibling = parent->right;
+
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              /* Take one black away from the sibling's side too
+                 and push the shortage up to the parent. */
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->right))
+                {
+                  sibling->left->red = false;
+                  sibling->red = true;
+                  rotate_right (tree, sibling);
+                  sibling = parent->right;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->right->red = false;
+              rotate_left (tree, parent);
+              e = tree->root;
+            }
+        }
+      else
+        {
+          struct rbtree_elem *sibling = parent->left;
+
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->left))
+                {
+                  sibling->right->red = false;
+                  sibling->red = true;
+                  rotate_left (tree, sibling);
+                  sibling = parent->left;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->left->red = false;
+              rotate_right (tree, parent);
+              e = tree->root;
+            }
+        }
+    }
+  if (e != NULL)
+    e->red = false;
+}
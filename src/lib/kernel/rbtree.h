@@ -0,0 +1,110 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Ordered set.
+
+   This is a red-black tree, a binary search tree whose height is
+   kept within twice the minimum by coloring each element red or
+   black.  Like the linked list in list.h, it does not require
+   use of dynamically allocated memory.  Instead, each structure
+   that can potentially be in a tree must embed a struct
+   rbtree_elem member.  All of the tree functions operate on
+   these `struct rbtree_elem's.  The rbtree_entry macro allows
+   conversion from a struct rbtree_elem back to a structure
+   object that contains it.  Refer to lib/kernel/list.h for a
+   detailed explanation of this technique.
+
+   The tree is ordered by a caller-supplied comparison function,
+   and two elements are equal if neither is less than the other.
+   A tree holds at most one of any set of equal elements, as
+   with a hash table, so a caller that wants to keep elements
+   with equal keys should break ties in its comparison function,
+   for example by comparing addresses.
+
+   Unlike a hash table, a tree can be traversed in order, and it
+   can find the elements whose keys fall in a given range.
+   Iteration idiom:
+
+      struct rbtree_elem *e;
+
+      for (e = rbtree_first (&tree); e != NULL; e = rbtree_next (e))
+        {
+          struct foo *f = rbtree_entry (e, struct foo, elem);
+          ...do something with f...
+        }
+
+   To visit the elements between LO and HI inclusive, start from
+   rbtree_lower_bound (&tree, &lo.elem) instead, and stop at the
+   first element greater than HI.
+
+   Costs, where n is the number of elements in the tree:
+
+     - rbtree_insert(), rbtree_remove(), rbtree_find(),
+       rbtree_lower_bound(), rbtree_upper_bound(),
+       rbtree_first(), rbtree_last(): O(lg n).
+
+     - rbtree_next(), rbtree_prev(): O(1) amortized over a full
+       traversal, O(lg n) worst case.
+
+   An element's key must not change while it is in a tree. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree element. */
+struct rbtree_elem
+  {
+    struct rbtree_elem *parent; /* Parent, or null if root. */
+    struct rbtree_elem *left;   /* Left child, with lesser keys. */
+    struct rbtree_elem *right;  /* Right child, with greater keys. */
+    bool red;                   /* Red or black? */
+  };
+
+/* Converts pointer to tree element RBTREE_ELEM into a pointer to
+   the structure that RBTREE_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element. */
+#define rbtree_entry(RBTREE_ELEM, STRUCT, MEMBER)       \
+        ((STRUCT *) ((uint8_t *) &(RBTREE_ELEM)->parent \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rbtree_less_func (const struct rbtree_elem *a,
+                               const struct rbtree_elem *b,
+                               void *aux);
+
+/* Red-black tree. */
+struct rbtree
+  {
+    struct rbtree_elem *root;   /* Root, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in tree. */
+    rbtree_less_func *less;     /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rbtree_init (struct rbtree *, rbtree_less_func *, void *aux);
+
+/* Search, insertion, deletion. */
+struct rbtree_elem *rbtree_insert (struct rbtree *, struct rbtree_elem *);
+void rbtree_remove (struct rbtree *, struct rbtree_elem *);
+struct rbtree_elem *rbtree_find (const struct rbtree *,
+                                 const struct rbtree_elem *);
+
+/* Ordered traversal and range queries. */
+struct rbtree_elem *rbtree_first (const struct rbtree *);
+struct rbtree_elem *rbtree_last (const struct rbtree *);
+struct rbtree_elem *rbtree_next (const struct rbtree_elem *);
+struct rbtree_elem *rbtree_prev (const struct rbtree_elem *);
+struct rbtree_elem *rbtree_lower_bound (const struct rbtree *,
+                                        const struct rbtree_elem *);
+struct rbtree_elem *rbtree_upper_bound (const struct rbtree *,
+                                        const struct rbtree_elem *);
+
+/* Tree properties. */
+size_t rbtree_size (const struct rbtree *);
+bool rbtree_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -1,5 +1,102 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* memcpy(), memmove(), memset(), strlen(), and strnlen() work a
+   32-bit word at a time once the destination (or, for the string
+   functions, the string) is word-aligned.  x86 tolerates
+   unaligned loads, so the source need not be aligned too.
+   Blocks of at least REP_THRESHOLD bytes are handed to the
+   "rep movsl" and "rep stosl" instructions instead, whose setup
+   cost only pays off for longer runs.
+
+   Accesses go through the may_alias type word_t so that the
+   compiler does not assume that they cannot touch the same
+   memory as the byte accesses around them. */
+typedef uint32_t word_t __attribute__ ((may_alias));
+#define WORD_SIZE sizeof (word_t)
+#define REP_THRESHOLD 64
+
+/* Returns true if P is word-aligned. */
+static inline bool
+word_aligned (const void *p)
+{
+  return (uintptr_t) p % WORD_SIZE == 0;
+}
+
+/* Returns nonzero if some byte in W is zero.  Subtracting 1 from
+   each byte borrows into its high bit only if the byte was zero
+   (or already had its high bit set, which ~W rules out). */
+static inline word_t
+has_zero_byte (word_t w)
+{
+  return (w - 0x01010101) & ~w & 0x80808080;
+}
+
+/* Copies SIZE bytes from SRC to DST, lowest address first. */
+static void
+copy_up (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  for (; size > 0 && !word_aligned (dst); size--)
+    *dst++ = *src++;
+
+  if (size >= REP_THRESHOLD)
+    {
+      size_t word_cnt = size / WORD_SIZE;
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (word_cnt)
+                    : : "memory");
+      size %= WORD_SIZE;
+    }
+  else
+    for (; size >= WORD_SIZE; size -= WORD_SIZE)
+      {
+        *(word_t *) dst = *(const word_t *) src;
+        dst += WORD_SIZE;
+        src += WORD_SIZE;
+      }
+
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+/* Copies SIZE bytes from SRC to DST, highest address first, so
+   that DST may overlap the end of SRC. */
+static void
+copy_down (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  dst += size;
+  src += size;
+  for (; size > 0 && !word_aligned (dst); size--)
+    *--dst = *--src;
+
+  if (size >= REP_THRESHOLD)
+    {
+      /* With the direction flag set, "rep movsl" starts at the
+         word at DI and SI and works downward.  Everything else
+         expects the flag to be clear, so clear it again. */
+      size_t word_cnt = size / WORD_SIZE;
+      dst -= WORD_SIZE;
+      src -= WORD_SIZE;
+      asm volatile ("std; rep movsl; cld"
+                    : "+D" (dst), "+S" (src), "+c" (word_cnt)
+                    : : "memory");
+      dst += WORD_SIZE;
+      src += WORD_SIZE;
+      size %= WORD_SIZE;
+    }
+  else
+    for (; size >= WORD_SIZE; size -= WORD_SIZE)
+      {
+        dst -= WORD_SIZE;
+        src -= WORD_SIZE;
+        *(word_t *) dst = *(const word_t *) src;
+      }
+
+  while (size-- > 0)
+    *--dst = *--src;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,8 +109,7 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  copy_up (dst, src, size);
 
   return dst_;
 }
@@ -29,20 +125,12 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
-    {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
-    }
+  if (dst <= src || dst >= src + size)
+    copy_up (dst, src, size);
+  else
+    copy_down (dst, src, size);
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -279,9 +367,27 @@ void *
 memset (void *dst_, int value, size_t size) 
 {
   unsigned char *dst = dst_;
+  word_t fill;
 
   ASSERT (dst != NULL || size == 0);
-  
+
+  for (; size > 0 && !word_aligned (dst); size--)
+    *dst++ = value;
+
+  fill = (unsigned char) value * 0x01010101u;
+  if (size >= REP_THRESHOLD)
+    {
+      size_t word_cnt = size / WORD_SIZE;
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (word_cnt)
+                    : "a" (fill)
+                    : "memory");
+      size %= WORD_SIZE;
+    }
+  else
+    for (; size >= WORD_SIZE; size -= WORD_SIZE, dst += WORD_SIZE)
+      *(word_t *) dst = fill;
+
   while (size-- > 0)
     *dst++ = value;
 
@@ -296,8 +402,15 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
-    continue;
+  /* An aligned word never straddles a page boundary, so reading
+     the whole word that holds the null terminator is safe. */
+  for (p = string; !word_aligned (p); p++)
+    if (*p == '\0')
+      return p - string;
+  while (!has_zero_byte (*(const word_t *) p))
+    p += WORD_SIZE;
+  while (*p != '\0')
+    p++;
   return p - string;
 }
 
@@ -306,10 +419,16 @@ strlen (const char *string)
 size_t
 strnlen (const char *string, size_t maxlen) 
 {
-  size_t length;
-
-  for (length = 0; string[length] != '\0' && length < maxlen; length++)
-    continue;
+  size_t length = 0;
+
+  for (; length < maxlen && !word_aligned (string + length); length++)
+    if (string[length] == '\0')
+      return length;
+  while (maxlen - length >= WORD_SIZE
+         && !has_zero_byte (*(const word_t *) (string + length)))
+    length += WORD_SIZE;
+  while (length < maxlen && string[length] != '\0')
+    length++;
   return length;
 }
 
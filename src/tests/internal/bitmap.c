@@ -0,0 +1,157 @@
+/* Test program and benchmark for lib/kernel/bitmap.c.
+
+   Checks bitmap_scan() and bitmap_scan_and_flip() against a
+   simple bit-at-a-time reference implementation on random
+   bitmaps, then times both on large, fragmented bitmaps.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Maximum number of bits in a bitmap used for correctness
+   testing. */
+#define MAX_BITS 300
+
+/* Number of bits in the bitmaps used for benchmarking. */
+#define BENCH_BITS (64 * 1024)
+
+static size_t reference_scan (const struct bitmap *, size_t start,
+                              size_t cnt, bool value);
+static void fragment (struct bitmap *, size_t max_run);
+static void benchmark (size_t bit_cnt, size_t cnt);
+
+/* Test and benchmark the bitmap implementation. */
+void
+test (void)
+{
+  size_t bit_cnt;
+
+  printf ("testing various size bitmaps:");
+  for (bit_cnt = 1; bit_cnt <= MAX_BITS; bit_cnt = bit_cnt * 3 / 2 + 1)
+    {
+      struct bitmap *b = bitmap_create (bit_cnt);
+      int repeat;
+
+      ASSERT (b != NULL);
+      printf (" %zu", bit_cnt);
+      for (repeat = 0; repeat < 1000; repeat++)
+        {
+          size_t start = random_ulong () % (bit_cnt + 1);
+          size_t cnt = random_ulong () % 12;
+          bool value = random_ulong () % 2;
+          size_t expect;
+
+          /* Randomly change part of the bitmap. */
+          if (random_ulong () % 2)
+            {
+              size_t ofs = random_ulong () % bit_cnt;
+              size_t len = random_ulong () % (bit_cnt - ofs + 1);
+              bitmap_set_multiple (b, ofs, len, random_ulong () % 2);
+            }
+          else
+            bitmap_flip (b, random_ulong () % bit_cnt);
+
+          expect = reference_scan (b, start, cnt, value);
+          ASSERT (bitmap_scan (b, start, cnt, value) == expect);
+          ASSERT (bitmap_scan_and_flip (b, start, cnt, value) == expect);
+          if (expect != BITMAP_ERROR && cnt > 0)
+            {
+              ASSERT (!bitmap_contains (b, expect, cnt, value));
+            }
+        }
+      bitmap_destroy (b);
+    }
+  printf (" done\n");
+
+  benchmark (BENCH_BITS, 1);
+  benchmark (BENCH_BITS, 8);
+  benchmark (BENCH_BITS, 64);
+  benchmark (BENCH_BITS * 4, 64);
+
+  printf ("bitmap: PASS\n");
+}
+
+/* Finds the first group of CNT bits in B at or after START that
+   are set to VALUE the slow way, one bit position at a time. */
+static size_t
+reference_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i, j;
+
+  if (cnt > bitmap_size (b))
+    return BITMAP_ERROR;
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Fills B with alternating runs of true and false bits, each
+   between 1 and MAX_RUN bits long, so that a scan for a group
+   longer than MAX_RUN false bits must pass over all of B. */
+static void
+fragment (struct bitmap *b, size_t max_run)
+{
+  size_t i = 0;
+  bool value = true;
+
+  while (i < bitmap_size (b))
+    {
+      size_t run = 1 + random_ulong () % max_run;
+      if (run > bitmap_size (b) - i)
+        run = bitmap_size (b) - i;
+      bitmap_set_multiple (b, i, run, value);
+      i += run;
+      value = !value;
+    }
+}
+
+/* Times scans for groups of CNT false bits in a fragmented
+   bitmap of BIT_CNT bits, where only the last CNT bits form a
+   large enough group. */
+static void
+benchmark (size_t bit_cnt, size_t cnt)
+{
+  struct bitmap *b = bitmap_create (bit_cnt);
+  int64_t start;
+  int64_t fast_ticks, slow_ticks;
+  size_t expect;
+  int i;
+
+  ASSERT (b != NULL);
+  fragment (b, cnt > 1 ? cnt - 1 : 1);
+  if (cnt == 1)
+    bitmap_set_all (b, true);
+  bitmap_set_multiple (b, bit_cnt - cnt, cnt, false);
+  bitmap_mark (b, bit_cnt - cnt - 1);
+  expect = bit_cnt - cnt;
+
+  start = timer_ticks ();
+  for (i = 0; i < 100; i++)
+    ASSERT (bitmap_scan (b, 0, cnt, false) == expect);
+  fast_ticks = timer_elapsed (start);
+
+  start = timer_ticks ();
+  ASSERT (reference_scan (b, 0, cnt, false) == expect);
+  slow_ticks = timer_elapsed (start);
+
+  printf ("%zu-bit bitmap, groups of %zu: "
+          "%"PRId64" ticks for 100 scans, "
+          "%"PRId64" ticks for 1 reference scan\n",
+          bit_cnt, cnt, fast_ticks, slow_ticks);
+  bitmap_destroy (b);
+}
@@ -0,0 +1,164 @@
+/* Test program for lib/kernel/hash.c.
+
+   Inserts, deletes, and looks up random keys while checking the
+   table against an array that records which keys should be
+   present.  This exercises lookups, iteration, and bulk
+   insertion in the middle of incremental resizes as the table
+   repeatedly grows and shrinks.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Number of distinct keys. */
+#define KEY_CNT 2048
+
+/* Number of operations per phase. */
+#define PHASE_OPS 20000
+
+/* Hash table element. */
+struct value
+  {
+    struct hash_elem elem;      /* Hash element. */
+    int key;                    /* Key. */
+    bool present;               /* In the table? */
+  };
+
+static struct value values[KEY_CNT];
+
+static unsigned value_hash (const struct hash_elem *, void *);
+static bool value_less (const struct hash_elem *, const struct hash_elem *,
+                        void *);
+static void verify (struct hash *, size_t cnt);
+
+/* Test the hash table implementation. */
+void
+test (void)
+{
+  struct hash h;
+  size_t cnt = 0;
+  int phase, i;
+
+  ASSERT (hash_init (&h, value_hash, value_less, NULL));
+  for (i = 0; i < KEY_CNT; i++)
+    {
+      values[i].key = i;
+      values[i].present = false;
+    }
+
+  printf ("testing hash table:");
+  for (phase = 0; phase < 8; phase++)
+    {
+      /* Even phases mostly insert, odd phases mostly delete. */
+      unsigned insert_pct = phase % 2 == 0 ? 80 : 20;
+      int op;
+
+      for (op = 0; op < PHASE_OPS; op++)
+        {
+          struct value *v = &values[random_ulong () % KEY_CNT];
+          struct value key;
+
+          key.key = v->key;
+          if (random_ulong () % 100 < insert_pct)
+            {
+              struct hash_elem *old = hash_insert (&h, &v->elem);
+              ASSERT ((old != NULL) == v->present);
+              if (old == NULL)
+                {
+                  v->present = true;
+                  cnt++;
+                }
+            }
+          else
+            {
+              struct hash_elem *old = hash_delete (&h, &key.elem);
+              ASSERT ((old != NULL) == v->present);
+              if (old != NULL)
+                {
+                  ASSERT (old == &v->elem);
+                  v->present = false;
+                  cnt--;
+                }
+            }
+          ASSERT ((hash_find (&h, &key.elem) != NULL) == v->present);
+
+          if (op % 1000 == 0)
+            verify (&h, cnt);
+        }
+      printf (" %zu", cnt);
+    }
+  printf (" done\n");
+
+  /* Bulk insertion of every key, some of which are present. */
+  printf ("testing bulk insertion:");
+  {
+    static struct hash_elem *elems[KEY_CNT];
+    size_t inserted;
+
+    for (i = 0; i < KEY_CNT; i++)
+      elems[i] = &values[i].elem;
+    inserted = hash_insert_bulk (&h, elems, KEY_CNT);
+    ASSERT (inserted == KEY_CNT - cnt);
+    for (i = 0; i < KEY_CNT; i++)
+      {
+        ASSERT (elems[i] == (values[i].present ? &values[i].elem : NULL));
+        values[i].present = true;
+      }
+    cnt = KEY_CNT;
+    verify (&h, cnt);
+  }
+  printf (" done\n");
+
+  hash_destroy (&h, NULL);
+
+  /* hash_reserve() sizes the table up front. */
+  ASSERT (hash_init (&h, value_hash, value_less, NULL));
+  ASSERT (hash_reserve (&h, KEY_CNT));
+  ASSERT (h.bucket_cnt * 2 >= KEY_CNT);
+  hash_destroy (&h, NULL);
+
+  printf ("hash: PASS\n");
+}
+
+/* Checks that iterating over H visits exactly the CNT values
+   marked present. */
+static void
+verify (struct hash *h, size_t cnt)
+{
+  struct hash_iterator i;
+  size_t visited = 0;
+
+  ASSERT (hash_size (h) == cnt);
+  hash_first (&i, h);
+  while (hash_next (&i))
+    {
+      struct value *v = hash_entry (hash_cur (&i), struct value, elem);
+      ASSERT (v->present);
+      visited++;
+    }
+  ASSERT (visited == cnt);
+}
+
+/* Returns a hash for the key of the value containing E. */
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct value, elem)->key);
+}
+
+/* Returns true if the key of the value containing A is less than
+   that of the value containing B. */
+static bool
+value_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct value, elem)->key
+          < hash_entry (b, struct value, elem)->key);
+}
@@ -0,0 +1,220 @@
+/* Test program and benchmark for lib/kernel/hashmap.c.
+
+   Checks a hash map against an array that records which keys
+   should be present, through a random mix of insertions,
+   deletions, and lookups, including with a hash function that
+   makes every key collide with many others.  Then times
+   lookup-heavy mixes of operations on a hash map and on a
+   struct hash holding the same keys.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <hashmap.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Number of distinct keys. */
+#define KEY_CNT 4096
+
+/* Number of operations in each correctness test and benchmark. */
+#define OP_CNT 200000
+
+/* An element of the struct hash used for comparison. */
+struct value
+  {
+    struct hash_elem elem;      /* Hash element. */
+    uintptr_t key;              /* Key. */
+    bool present;               /* In the table? */
+  };
+
+static struct value values[KEY_CNT];
+
+static void test_map (hashmap_hash_func *, int op_cnt);
+static void benchmark (unsigned find_pct);
+static unsigned colliding_hash (uintptr_t, void *);
+static unsigned value_hash (const struct hash_elem *, void *);
+static bool value_less (const struct hash_elem *, const struct hash_elem *,
+                        void *);
+
+/* Test and benchmark the hash map implementation. */
+void
+test (void)
+{
+  printf ("testing hash map:");
+  test_map (hashmap_hash_uint, OP_CNT);
+  printf (" good hash");
+  test_map (colliding_hash, OP_CNT / 10);
+  printf (" colliding hash");
+  printf (" done\n");
+
+  benchmark (90);
+  benchmark (99);
+
+  printf ("hashmap: PASS\n");
+}
+
+/* Performs a random mix of operations on a hash map that uses
+   HASH, checking each result. */
+static void
+test_map (hashmap_hash_func *hash, int op_cnt)
+{
+  struct hashmap m;
+  struct hashmap_iterator i;
+  size_t cnt = 0, visited = 0;
+  int op;
+
+  ASSERT (hashmap_init (&m, hash, hashmap_less_uint, NULL));
+  for (op = 0; op < KEY_CNT; op++)
+    values[op].present = false;
+
+  for (op = 0; op < op_cnt; op++)
+    {
+      uintptr_t key = random_ulong () % KEY_CNT;
+      struct value *v = &values[key];
+
+      switch (random_ulong () % 3)
+        {
+        case 0:
+          ASSERT (hashmap_insert (&m, key, v) == !v->present);
+          if (!v->present)
+            {
+              v->present = true;
+              cnt++;
+            }
+          break;
+
+        case 1:
+          ASSERT (hashmap_delete (&m, key) == (v->present ? v : NULL));
+          if (v->present)
+            {
+              v->present = false;
+              cnt--;
+            }
+          break;
+
+        case 2:
+          ASSERT (hashmap_find (&m, key) == (v->present ? v : NULL));
+          break;
+        }
+      ASSERT (hashmap_size (&m) == cnt);
+    }
+
+  hashmap_first (&i, &m);
+  while (hashmap_next (&i))
+    {
+      ASSERT (hashmap_cur_value (&i) == &values[hashmap_cur_key (&i)]);
+      ASSERT (values[hashmap_cur_key (&i)].present);
+      visited++;
+    }
+  ASSERT (visited == cnt);
+
+  hashmap_destroy (&m, NULL);
+}
+
+/* Times OP_CNT operations, FIND_PCT percent of them lookups and
+   the rest split between insertions and deletions, on a struct
+   hash and on a hash map, each starting out with half of the
+   keys present. */
+static void
+benchmark (unsigned find_pct)
+{
+  static uintptr_t keys[OP_CNT];
+  static unsigned kinds[OP_CNT];
+  struct hash h;
+  struct hashmap m;
+  int64_t start, hash_ticks, map_ticks;
+  int op;
+
+  /* Choose the operations up front, so that both tables see the
+     same sequence and the random number generator is not
+     timed. */
+  for (op = 0; op < OP_CNT; op++)
+    {
+      unsigned pct = random_ulong () % 100;
+      keys[op] = random_ulong () % KEY_CNT;
+      kinds[op] = pct < find_pct ? 0 : pct % 2 + 1;
+    }
+
+  ASSERT (hash_init (&h, value_hash, value_less, NULL));
+  ASSERT (hashmap_init (&m, hashmap_hash_uint, hashmap_less_uint, NULL));
+  for (op = 0; op < KEY_CNT; op++)
+    {
+      values[op].key = op;
+      values[op].present = op % 2 == 0;
+      if (values[op].present)
+        {
+          hash_insert (&h, &values[op].elem);
+          hashmap_insert (&m, op, &values[op]);
+        }
+    }
+
+  start = timer_ticks ();
+  for (op = 0; op < OP_CNT; op++)
+    {
+      struct value *v = &values[keys[op]];
+      struct value key;
+
+      key.key = keys[op];
+      if (kinds[op] == 0)
+        hash_find (&h, &key.elem);
+      else if (kinds[op] == 1)
+        hash_insert (&h, &v->elem);
+      else
+        hash_delete (&h, &key.elem);
+    }
+  hash_ticks = timer_elapsed (start);
+
+  start = timer_ticks ();
+  for (op = 0; op < OP_CNT; op++)
+    {
+      if (kinds[op] == 0)
+        hashmap_find (&m, keys[op]);
+      else if (kinds[op] == 1)
+        hashmap_insert (&m, keys[op], &values[keys[op]]);
+      else
+        hashmap_delete (&m, keys[op]);
+    }
+  map_ticks = timer_elapsed (start);
+
+  ASSERT (hash_size (&h) == hashmap_size (&m));
+  printf ("%d operations, %u%% lookups: "
+          "%"PRId64" ticks for struct hash, %"PRId64" ticks for hash map\n",
+          OP_CNT, find_pct, hash_ticks, map_ticks);
+
+  hash_destroy (&h, NULL);
+  hashmap_destroy (&m, NULL);
+}
+
+/* A poor hash function that maps every key to one of just 16
+   values. */
+static unsigned
+colliding_hash (uintptr_t key, void *aux UNUSED)
+{
+  return key % 16;
+}
+
+/* Returns a hash for the key of the value containing E, the
+   same as the hash map uses. */
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hashmap_hash_uint (hash_entry (e, struct value, elem)->key, NULL);
+}
+
+/* Returns true if the key of the value containing A is less than
+   that of the value containing B. */
+static bool
+value_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct value, elem)->key
+          < hash_entry (b, struct value, elem)->key);
+}
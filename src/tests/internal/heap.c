@@ -0,0 +1,229 @@
+/* Test program and benchmark for lib/kernel/heap.c.
+
+   Pushes, pops, removes, and changes the keys of random
+   elements, checking each popped element against a brute-force
+   search for the minimum.  Then times the heap against a list
+   kept in order with list_insert_ordered(), the way the
+   scheduler's queues used to be kept.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <heap.h>
+#include <inttypes.h>
+#include <list.h>
+#include <random.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Number of elements for correctness testing. */
+#define ELEM_CNT 256
+
+/* Numbers of elements and operations for benchmarking. */
+#define BENCH_MIN 64
+#define BENCH_MAX 4096
+#define BENCH_OPS 20000
+
+/* A value in a heap or list. */
+struct value
+  {
+    struct heap_elem elem;      /* Heap element. */
+    struct list_elem list_elem; /* List element. */
+    int key;                    /* Key. */
+    bool present;               /* In the heap? */
+  };
+
+static struct value values[BENCH_MAX];
+
+static void test_changes (void);
+static struct value *find_min (void);
+static void benchmark (int cnt);
+static bool value_less (const struct heap_elem *, const struct heap_elem *,
+                        void *);
+static bool value_list_less (const struct list_elem *,
+                             const struct list_elem *, void *);
+
+/* Test and benchmark the heap. */
+void
+test (void)
+{
+  int cnt;
+
+  test_changes ();
+  for (cnt = BENCH_MIN; cnt <= BENCH_MAX; cnt *= 4)
+    benchmark (cnt);
+
+  printf ("heap: PASS\n");
+}
+
+/* Performs random operations on a heap, checking the minimum as
+   we go. */
+static void
+test_changes (void)
+{
+  struct heap heap;
+  size_t cnt = 0;
+  int i, op;
+
+  heap_init (&heap, value_less, NULL);
+  for (i = 0; i < ELEM_CNT; i++)
+    values[i].present = false;
+
+  printf ("testing heap:");
+  for (op = 0; op < 100 * ELEM_CNT; op++)
+    {
+      struct value *v = &values[random_ulong () % ELEM_CNT];
+
+      switch (random_ulong () % 5)
+        {
+        case 0:
+        case 1:
+          /* Push. */
+          if (!v->present)
+            {
+              v->key = random_ulong () % 1000;
+              v->present = true;
+              heap_push (&heap, &v->elem);
+              cnt++;
+            }
+          break;
+
+        case 2:
+          /* Pop, which must yield a minimum.  Keys may repeat, so
+             compare keys rather than elements. */
+          if (cnt > 0)
+            {
+              struct value *min = find_min ();
+              struct value *top = heap_entry (heap_pop (&heap),
+                                              struct value, elem);
+              ASSERT (top->present);
+              ASSERT (top->key == min->key);
+              top->present = false;
+              cnt--;
+            }
+          break;
+
+        case 3:
+          /* Remove an arbitrary element. */
+          if (v->present)
+            {
+              heap_remove (&heap, &v->elem);
+              v->present = false;
+              cnt--;
+            }
+          break;
+
+        case 4:
+          /* Change a key, in either direction. */
+          if (v->present)
+            {
+              int old_key = v->key;
+              v->key = random_ulong () % 1000;
+              if (v->key <= old_key)
+                heap_decrease (&heap, &v->elem);
+              else
+                heap_update (&heap, &v->elem);
+            }
+          break;
+        }
+
+      ASSERT (heap_size (&heap) == cnt);
+      ASSERT (heap_empty (&heap) == (cnt == 0));
+      if (cnt > 0)
+        {
+          ASSERT (heap_entry (heap_top (&heap), struct value, elem)->key
+                  == find_min ()->key);
+        }
+      if (op % (10 * ELEM_CNT) == 0)
+        printf (" %zu", cnt);
+    }
+  printf (" done\n");
+}
+
+/* Returns a value with the least key among those marked present,
+   searching the slow way. */
+static struct value *
+find_min (void)
+{
+  struct value *min = NULL;
+  int i;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    if (values[i].present && (min == NULL || values[i].key < min->key))
+      min = &values[i];
+  ASSERT (min != NULL);
+  return min;
+}
+
+/* Times BENCH_OPS operations, each popping the least element and
+   pushing it back with a new key, on a heap and on an ordered
+   list that each hold CNT elements. */
+static void
+benchmark (int cnt)
+{
+  static int keys[BENCH_OPS];
+  struct heap heap;
+  struct list list;
+  int64_t start, heap_ticks, list_ticks;
+  int i;
+
+  for (i = 0; i < BENCH_OPS; i++)
+    keys[i] = random_ulong () % 100000;
+
+  heap_init (&heap, value_less, NULL);
+  for (i = 0; i < cnt; i++)
+    {
+      values[i].key = random_ulong () % 100000;
+      heap_push (&heap, &values[i].elem);
+    }
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_OPS; i++)
+    {
+      struct value *v = heap_entry (heap_pop (&heap), struct value, elem);
+      v->key = keys[i];
+      heap_push (&heap, &v->elem);
+    }
+  heap_ticks = timer_elapsed (start);
+
+  /* The heap loop changed the keys, so build the list only now. */
+  list_init (&list);
+  for (i = 0; i < cnt; i++)
+    list_insert_ordered (&list, &values[i].list_elem, value_list_less, NULL);
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_OPS; i++)
+    {
+      struct value *v = list_entry (list_pop_front (&list),
+                                    struct value, list_elem);
+      v->key = keys[i];
+      list_insert_ordered (&list, &v->list_elem, value_list_less, NULL);
+    }
+  list_ticks = timer_elapsed (start);
+
+  printf ("%d elements, %d operations: %"PRId64" ticks for heap, "
+          "%"PRId64" ticks for ordered list\n",
+          cnt, BENCH_OPS, heap_ticks, list_ticks);
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_less (const struct heap_elem *a, const struct heap_elem *b,
+            void *aux UNUSED)
+{
+  return (heap_entry (a, struct value, elem)->key
+          < heap_entry (b, struct value, elem)->key);
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_list_less (const struct list_elem *a, const struct list_elem *b,
+                 void *aux UNUSED)
+{
+  return (list_entry (a, struct value, list_elem)->key
+          < list_entry (b, struct value, list_elem)->key);
+}
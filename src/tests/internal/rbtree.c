@@ -0,0 +1,280 @@
+/* Test program and benchmark for lib/kernel/rbtree.c.
+
+   Inserts and removes random keys, checking after each change
+   that the tree is a valid red-black tree holding exactly the
+   keys it should, in order, and that range queries return the
+   right elements.  Then times the tree against a list kept in
+   order with list_insert_ordered().
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <list.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Number of distinct keys for correctness testing. */
+#define KEY_CNT 512
+
+/* Numbers of elements for benchmarking. */
+#define BENCH_MIN 256
+#define BENCH_MAX 4096
+
+/* A value in a tree or list. */
+struct value
+  {
+    struct rbtree_elem elem;    /* Tree element. */
+    struct list_elem list_elem; /* List element. */
+    int key;                    /* Key. */
+    bool present;               /* In the tree? */
+  };
+
+static struct value values[BENCH_MAX];
+
+static void test_changes (void);
+static void test_ranges (struct rbtree *);
+static void verify (struct rbtree *, size_t cnt);
+static int verify_subtree (struct rbtree_elem *);
+static void benchmark (int cnt);
+static bool value_less (const struct rbtree_elem *, const struct rbtree_elem *,
+                        void *);
+static bool value_list_less (const struct list_elem *,
+                             const struct list_elem *, void *);
+static void shuffle (struct value *[], size_t);
+
+/* Test and benchmark the red-black tree. */
+void
+test (void)
+{
+  int cnt;
+
+  test_changes ();
+  for (cnt = BENCH_MIN; cnt <= BENCH_MAX; cnt *= 4)
+    benchmark (cnt);
+
+  printf ("rbtree: PASS\n");
+}
+
+/* Inserts and removes random keys, verifying the tree as we
+   go. */
+static void
+test_changes (void)
+{
+  struct rbtree tree;
+  size_t cnt = 0;
+  int i, op;
+
+  rbtree_init (&tree, value_less, NULL);
+  for (i = 0; i < KEY_CNT; i++)
+    {
+      values[i].key = i;
+      values[i].present = false;
+    }
+
+  printf ("testing red-black tree:");
+  for (op = 0; op < 20 * KEY_CNT; op++)
+    {
+      struct value *v = &values[random_ulong () % KEY_CNT];
+
+      /* Lean toward inserting in the first half of the test and
+         toward removing in the second half. */
+      if (random_ulong () % 4 != 0 ? op < 10 * KEY_CNT : op >= 10 * KEY_CNT)
+        {
+          struct rbtree_elem *old = rbtree_insert (&tree, &v->elem);
+          ASSERT (old == (v->present ? &v->elem : NULL));
+          if (!v->present)
+            {
+              v->present = true;
+              cnt++;
+            }
+        }
+      else if (v->present)
+        {
+          rbtree_remove (&tree, &v->elem);
+          v->present = false;
+          cnt--;
+        }
+      ASSERT ((rbtree_find (&tree, &v->elem) != NULL) == v->present);
+
+      verify (&tree, cnt);
+      if (op % 64 == 0)
+        test_ranges (&tree);
+      if (op % (2 * KEY_CNT) == 0)
+        printf (" %zu", cnt);
+    }
+  printf (" done\n");
+}
+
+/* Checks rbtree_lower_bound() and rbtree_upper_bound() for every
+   key, against the marks in VALUES. */
+static void
+test_ranges (struct rbtree *tree)
+{
+  int key;
+
+  for (key = 0; key < KEY_CNT; key++)
+    {
+      struct rbtree_elem *lower = rbtree_lower_bound (tree, &values[key].elem);
+      struct rbtree_elem *upper = rbtree_upper_bound (tree, &values[key].elem);
+      int next;
+
+      for (next = key; next < KEY_CNT && !values[next].present; next++)
+        continue;
+      ASSERT (lower == (next < KEY_CNT ? &values[next].elem : NULL));
+
+      for (next = key + 1; next < KEY_CNT && !values[next].present; next++)
+        continue;
+      ASSERT (upper == (next < KEY_CNT ? &values[next].elem : NULL));
+    }
+}
+
+/* Checks that TREE is a valid red-black tree that contains the
+   CNT values marked present, in increasing order forward and
+   decreasing order backward. */
+static void
+verify (struct rbtree *tree, size_t cnt)
+{
+  struct rbtree_elem *e;
+  size_t visited;
+  int key;
+
+  ASSERT (rbtree_size (tree) == cnt);
+  ASSERT (rbtree_empty (tree) == (cnt == 0));
+  ASSERT (tree->root == NULL || (tree->root->parent == NULL
+                                 && !tree->root->red));
+  verify_subtree (tree->root);
+
+  visited = 0;
+  key = -1;
+  for (e = rbtree_first (tree); e != NULL; e = rbtree_next (e))
+    {
+      struct value *v = rbtree_entry (e, struct value, elem);
+      ASSERT (v->present);
+      ASSERT (v->key > key);
+      key = v->key;
+      visited++;
+    }
+  ASSERT (visited == cnt);
+
+  visited = 0;
+  for (e = rbtree_last (tree); e != NULL; e = rbtree_prev (e))
+    {
+      struct value *v = rbtree_entry (e, struct value, elem);
+      ASSERT (v->key <= key);
+      key = v->key;
+      visited++;
+    }
+  ASSERT (visited == cnt);
+}
+
+/* Checks the links and colors in the subtree rooted at E and
+   returns its black height. */
+static int
+verify_subtree (struct rbtree_elem *e)
+{
+  int left_height, right_height;
+
+  if (e == NULL)
+    return 1;
+
+  ASSERT (e->left == NULL || e->left->parent == e);
+  ASSERT (e->right == NULL || e->right->parent == e);
+  ASSERT (!e->red || ((e->left == NULL || !e->left->red)
+                      && (e->right == NULL || !e->right->red)));
+
+  left_height = verify_subtree (e->left);
+  right_height = verify_subtree (e->right);
+  ASSERT (left_height == right_height);
+  return left_height + !e->red;
+}
+
+/* Times inserting CNT values in random order, looking each one
+   up, and removing them all in random order, with a red-black
+   tree and with an ordered list. */
+static void
+benchmark (int cnt)
+{
+  static struct value *order[BENCH_MAX];
+  struct rbtree tree;
+  struct list list;
+  int64_t start, tree_ticks, list_ticks;
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      values[i].key = i;
+      order[i] = &values[i];
+    }
+  shuffle (order, cnt);
+
+  start = timer_ticks ();
+  rbtree_init (&tree, value_less, NULL);
+  for (i = 0; i < cnt; i++)
+    rbtree_insert (&tree, &order[i]->elem);
+  for (i = 0; i < cnt; i++)
+    ASSERT (rbtree_find (&tree, &values[i].elem) == &values[i].elem);
+  for (i = cnt - 1; i >= 0; i--)
+    rbtree_remove (&tree, &order[i]->elem);
+  tree_ticks = timer_elapsed (start);
+
+  start = timer_ticks ();
+  list_init (&list);
+  for (i = 0; i < cnt; i++)
+    list_insert_ordered (&list, &order[i]->list_elem, value_list_less, NULL);
+  for (i = 0; i < cnt; i++)
+    {
+      struct list_elem *e;
+
+      for (e = list_begin (&list); e != list_end (&list); e = list_next (e))
+        if (list_entry (e, struct value, list_elem) == &values[i])
+          break;
+      ASSERT (e != list_end (&list));
+    }
+  for (i = cnt - 1; i >= 0; i--)
+    list_remove (&order[i]->list_elem);
+  list_ticks = timer_elapsed (start);
+
+  printf ("%d elements: %"PRId64" ticks for red-black tree, "
+          "%"PRId64" ticks for ordered list\n",
+          cnt, tree_ticks, list_ticks);
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_less (const struct rbtree_elem *a, const struct rbtree_elem *b,
+            void *aux UNUSED)
+{
+  return (rbtree_entry (a, struct value, elem)->key
+          < rbtree_entry (b, struct value, elem)->key);
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_list_less (const struct list_elem *a, const struct list_elem *b,
+                 void *aux UNUSED)
+{
+  return (list_entry (a, struct value, list_elem)->key
+          < list_entry (b, struct value, list_elem)->key);
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value *array[], size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
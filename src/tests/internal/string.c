@@ -0,0 +1,231 @@
+/* Test program and benchmark for the block and string length
+   functions in lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), strlen(), and strnlen()
+   against simple byte-at-a-time versions at every combination of
+   small offsets and lengths, then times both versions on
+   page-sized blocks.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Size of the buffers used for correctness testing. */
+#define BUF_SIZE 256
+
+/* Size of a block and number of repetitions for benchmarking. */
+#define BENCH_SIZE 4096
+#define BENCH_REPEAT 2000
+
+static void *byte_memcpy (void *, const void *, size_t);
+static void *byte_memmove (void *, const void *, size_t);
+static void *byte_memset (void *, int, size_t);
+static size_t byte_strlen (const char *);
+static size_t byte_strnlen (const char *, size_t);
+
+static void test_copies (void);
+static void test_lengths (void);
+static void benchmark (void);
+
+/* Test and benchmark the string functions. */
+void
+test (void)
+{
+  test_copies ();
+  test_lengths ();
+  benchmark ();
+
+  printf ("string: PASS\n");
+}
+
+/* Checks memcpy(), memmove(), and memset() at every source
+   offset, destination offset, and length small enough to cover
+   all the alignment cases. */
+static void
+test_copies (void)
+{
+  static unsigned char src[BUF_SIZE], actual[BUF_SIZE], expect[BUF_SIZE];
+  size_t dst_ofs, src_ofs, size;
+
+  printf ("testing memcpy, memmove, memset:");
+  for (size = 0; size < BUF_SIZE / 2; size = size < 16 ? size + 1 : size * 2)
+    {
+      printf (" %zu", size);
+      for (dst_ofs = 0; dst_ofs < 8; dst_ofs++)
+        for (src_ofs = 0; src_ofs < 8; src_ofs++)
+          {
+            int value = random_ulong ();
+
+            random_bytes (src, sizeof src);
+            random_bytes (actual, sizeof actual);
+            memcpy (expect, actual, sizeof expect);
+            byte_memcpy (expect + dst_ofs, src + src_ofs, size);
+            ASSERT (memcpy (actual + dst_ofs, src + src_ofs, size)
+                    == actual + dst_ofs);
+            ASSERT (!memcmp (actual, expect, sizeof actual));
+
+            /* Overlapping moves in both directions. */
+            byte_memmove (expect + dst_ofs, expect + src_ofs, size);
+            ASSERT (memmove (actual + dst_ofs, actual + src_ofs, size)
+                    == actual + dst_ofs);
+            ASSERT (!memcmp (actual, expect, sizeof actual));
+
+            byte_memset (expect + dst_ofs, value, size);
+            ASSERT (memset (actual + dst_ofs, value, size)
+                    == actual + dst_ofs);
+            ASSERT (!memcmp (actual, expect, sizeof actual));
+          }
+    }
+  printf (" done\n");
+}
+
+/* Checks strlen() and strnlen() at every string offset and
+   every length up to a few words. */
+static void
+test_lengths (void)
+{
+  static char buf[BUF_SIZE];
+  size_t ofs, len, maxlen;
+
+  printf ("testing strlen, strnlen:");
+  for (len = 0; len < 40; len++)
+    {
+      printf (" %zu", len);
+      for (ofs = 0; ofs < 8; ofs++)
+        {
+          memset (buf, 'x', sizeof buf);
+          buf[ofs + len] = '\0';
+
+          ASSERT (strlen (buf + ofs) == len);
+          ASSERT (byte_strlen (buf + ofs) == len);
+          for (maxlen = 0; maxlen < len + 8; maxlen++)
+            ASSERT (strnlen (buf + ofs, maxlen)
+                    == byte_strnlen (buf + ofs, maxlen));
+        }
+    }
+  printf (" done\n");
+}
+
+/* Runs STMT BENCH_REPEAT times and returns the elapsed ticks. */
+#define TIME(STMT)                                      \
+        ({                                              \
+          int64_t start_ = timer_ticks ();              \
+          int i_;                                       \
+          for (i_ = 0; i_ < BENCH_REPEAT; i_++)         \
+            STMT;                                       \
+          timer_elapsed (start_);                       \
+        })
+
+/* Prints the ticks taken by the byte-at-a-time and the library
+   version of an operation. */
+static void
+report (const char *name, int64_t byte_ticks, int64_t lib_ticks)
+{
+  printf ("%s: %"PRId64" ticks byte-at-a-time, %"PRId64" ticks lib/string.c\n",
+          name, byte_ticks, lib_ticks);
+}
+
+/* Times each function against its byte-at-a-time version on
+   BENCH_SIZE-byte blocks. */
+static void
+benchmark (void)
+{
+  static char a[BENCH_SIZE + 1], b[BENCH_SIZE + 1];
+
+  printf ("%d repetitions on %d-byte blocks:\n", BENCH_REPEAT, BENCH_SIZE);
+
+  report ("memcpy",
+          TIME (byte_memcpy (a, b, BENCH_SIZE)),
+          TIME (memcpy (a, b, BENCH_SIZE)));
+  report ("memcpy, misaligned",
+          TIME (byte_memcpy (a + 1, b + 2, BENCH_SIZE - 2)),
+          TIME (memcpy (a + 1, b + 2, BENCH_SIZE - 2)));
+  report ("memmove, overlapping",
+          TIME (byte_memmove (a + 4, a, BENCH_SIZE - 4)),
+          TIME (memmove (a + 4, a, BENCH_SIZE - 4)));
+  report ("memset",
+          TIME (byte_memset (a, 0, BENCH_SIZE)),
+          TIME (memset (a, 0, BENCH_SIZE)));
+
+  memset (a, 'x', BENCH_SIZE);
+  a[BENCH_SIZE] = '\0';
+  report ("strlen",
+          TIME (ASSERT (byte_strlen (a) == BENCH_SIZE)),
+          TIME (ASSERT (strlen (a) == BENCH_SIZE)));
+  report ("strnlen",
+          TIME (ASSERT (byte_strnlen (a, BENCH_SIZE) == BENCH_SIZE)),
+          TIME (ASSERT (strnlen (a, BENCH_SIZE) == BENCH_SIZE)));
+}
+
+/* Byte-at-a-time reference versions. */
+
+static void *
+byte_memcpy (void *dst_, const void *src_, size_t size)
+{
+  unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+static void *
+byte_memmove (void *dst_, const void *src_, size_t size)
+{
+  unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  if (dst < src)
+    {
+      while (size-- > 0)
+        *dst++ = *src++;
+    }
+  else
+    {
+      dst += size;
+      src += size;
+      while (size-- > 0)
+        *--dst = *--src;
+    }
+  return dst_;
+}
+
+static void *
+byte_memset (void *dst_, int value, size_t size)
+{
+  unsigned char *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+static size_t
+byte_strlen (const char *string)
+{
+  const char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
+
+static size_t
+byte_strnlen (const char *string, size_t maxlen)
+{
+  size_t length;
+
+  for (length = 0; length < maxlen && string[length] != '\0'; length++)
+    continue;
+  return length;
+}
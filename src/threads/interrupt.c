@@ -50,6 +50,7 @@ static bool yield_on_return;    /* Should we yield on interrupt return? */
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
+static bool pic_pending (int irq);
 
 /* Interrupt Descriptor Table helpers. */
 static uint64_t make_intr_gate (void (*) (void), int dpl);
@@ -225,6 +226,17 @@ intr_yield_on_return (void)
   yield_on_return = true;
 }
 
+/* Returns true if external interrupt VEC_NO has been raised but
+   not yet delivered to the CPU, as happens while interrupts are
+   disabled. */
+bool
+intr_ext_pending (uint8_t vec_no)
+{
+  ASSERT (vec_no >= 0x20 && vec_no < 0x30);
+
+  return pic_pending (vec_no);
+}
+
 /* 8259A Programmable Interrupt Controller. */
 
 /* Initializes the PICs.  Refer to [8259A] for details.
@@ -274,6 +286,26 @@ pic_end_of_interrupt (int irq)
     outb (0xa0, 0x20);
 }
 
+/* Returns true if the given IRQ is set in its PIC's interrupt
+   request register, that is, it has been raised but not yet
+   acknowledged by the CPU. */
+static bool
+pic_pending (int irq)
+{
+  ASSERT (irq >= 0x20 && irq < 0x30);
+
+  if (irq < 0x28)
+    {
+      outb (PIC0_CTRL, 0x0a);   /* OCW3: read IRR. */
+      return (inb (PIC0_CTRL) >> (irq - 0x20)) & 1;
+    }
+  else
+    {
+      outb (PIC1_CTRL, 0x0a);   /* OCW3: read IRR. */
+      return (inb (PIC1_CTRL) >> (irq - 0x28)) & 1;
+    }
+}
+
 /* Creates an gate that invokes FUNCTION.
 
    The gate has descriptor privilege level DPL, meaning that it
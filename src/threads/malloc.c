@@ -32,7 +32,10 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Fixed-size objects allocated at a high rate should use an
+   object cache instead; see kmem_cache_create() below. */
 
 /* Descriptor. */
 struct desc
@@ -292,3 +295,279 @@ arena_to_block (struct arena *a, size_t idx)
                            + sizeof *a
                            + idx * a->desc->block_size);
 }
+
+/* Object caches.
+
+   A cache hands out objects of a single, exact size, so that
+   kernel structures allocated at a high rate do not pay for the
+   rounding to a power of 2 done by malloc().  Objects are carved
+   out of one-page "slabs".  Each slab starts with a header, then
+   an array that links the slab's free objects by index, then the
+   objects themselves.  Keeping the free links outside the objects
+   means that a free object keeps the state given to it by the
+   cache's constructor, which therefore runs only once per object,
+   when its slab is created.
+
+   A cache keeps its slabs on three lists: full slabs, partially
+   used slabs, and empty slabs.  Objects are allocated from
+   partial slabs first, so that the other slabs can drain and
+   become empty.  Up to EMPTY_SLABS_MAX empty slabs are kept to
+   absorb bursts of allocation and freeing; more than that are
+   returned to the page allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Number of empty slabs kept by each cache. */
+#define EMPTY_SLABS_MAX 1
+
+/* Object cache. */
+struct kmem_cache
+  {
+    const char *name;           /* Name (for debugging purposes). */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    size_t obj_ofs;             /* Offset of first object in slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct list full;           /* Slabs with no free objects. */
+    struct list partial;        /* Slabs with some free objects. */
+    struct list empty;          /* Slabs with no objects in use. */
+    size_t empty_cnt;           /* Number of slabs in `empty'. */
+    struct lock lock;           /* Lock. */
+  };
+
+/* Value of a free-list link that ends the list. */
+#define SLAB_END UINT16_MAX
+
+/* Slab. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of cache's lists. */
+    size_t in_use;              /* Number of allocated objects. */
+    uint16_t free;              /* Index of first free object. */
+    uint16_t next[];            /* Index of next free object. */
+  };
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void *slab_obj (struct slab *, size_t idx);
+
+/* Creates and returns a cache of objects of SIZE bytes each,
+   naming it NAME for debugging purposes.  If CTOR is nonnull,
+   it is called on each object when it is first created.
+   Returns a null pointer if memory is not available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor)
+{
+  struct kmem_cache *c;
+  size_t n;
+
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  /* Objects are word-aligned.  Find the largest number of
+     objects that fit in a page along with the slab header and
+     the free links. */
+  size = ROUND_UP (size, sizeof (uint32_t));
+  for (n = (PGSIZE - sizeof (struct slab)) / size; n > 0; n--)
+    if (ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+                  sizeof (uint32_t)) + n * size <= PGSIZE)
+      break;
+  ASSERT (n > 0 && n < SLAB_END);
+
+  c->name = name;
+  c->obj_size = size;
+  c->objs_per_slab = n;
+  c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+                         sizeof (uint32_t));
+  c->ctor = ctor;
+  list_init (&c->full);
+  list_init (&c->partial);
+  list_init (&c->empty);
+  c->empty_cnt = 0;
+  lock_init (&c->lock);
+  return c;
+}
+
+/* Destroys cache C, which must not have any objects in use. */
+void
+kmem_cache_destroy (struct kmem_cache *c)
+{
+  if (c == NULL)
+    return;
+
+  ASSERT (list_empty (&c->full));
+  ASSERT (list_empty (&c->partial));
+  while (!list_empty (&c->empty))
+    palloc_free_page (list_entry (list_pop_front (&c->empty),
+                                  struct slab, elem));
+  free (c);
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+
+  /* Prefer a partial slab, then an empty one, then a new one. */
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty))
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      c->empty_cnt--;
+      list_push_front (&c->partial, &s->elem);
+    }
+  else
+    {
+      s = slab_create (c);
+      if (s == NULL)
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Take the first free object. */
+  ASSERT (s->free != SLAB_END);
+  obj = slab_obj (s, s->free);
+  s->free = s->next[s->free];
+  if (++s->in_use == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Obtains an object from cache C, fills it with zeros, and
+   returns it.  Returns a null pointer if memory is not
+   available.  Only useful for caches without a constructor. */
+void *
+kmem_cache_zalloc (struct kmem_cache *c)
+{
+  void *obj = kmem_cache_alloc (c);
+  if (obj != NULL)
+    memset (obj, 0, c->obj_size);
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  Does nothing if OBJ is null. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+  size_t idx;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+  idx = ((uint8_t *) obj - (uint8_t *) s - c->obj_ofs) / c->obj_size;
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it must keep its constructed state. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+
+  /* Add object to the slab's free list. */
+  ASSERT (s->in_use > 0);
+  s->next[idx] = s->free;
+  s->free = idx;
+
+  /* Move the slab to the list that now describes it. */
+  if (s->in_use-- == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  if (s->in_use == 0)
+    {
+      list_remove (&s->elem);
+      if (c->empty_cnt < EMPTY_SLABS_MAX)
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else
+        {
+          s->magic = 0;
+          palloc_free_page (s);
+        }
+    }
+
+  lock_release (&c->lock);
+}
+
+/* Allocates a new slab for cache C, with all of its objects
+   free and constructed.  Returns a null pointer if memory is
+   not available.  C's lock must be held. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->in_use = 0;
+  s->free = 0;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : SLAB_END;
+      if (c->ctor != NULL)
+        c->ctor (slab_obj (s, i));
+    }
+  return s;
+}
+
+/* Returns the slab of cache C that OBJ is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid. */
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the IDX'th object within slab S. */
+static void *
+slab_obj (struct slab *s, size_t idx)
+{
+  ASSERT (idx < s->cache->objs_per_slab);
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
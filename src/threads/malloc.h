@@ -10,4 +10,19 @@ void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
 
+/* Object caches ("slab allocator"). */
+struct kmem_cache;
+
+/* Constructor for cached objects, called once on each object
+   when the slab holding it is created.  Objects must be returned
+   to kmem_cache_free() in their constructed state. */
+typedef void kmem_ctor_func (void *obj);
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+                                      kmem_ctor_func *);
+void kmem_cache_destroy (struct kmem_cache *);
+void *kmem_cache_alloc (struct kmem_cache *) __attribute__ ((malloc));
+void *kmem_cache_zalloc (struct kmem_cache *) __attribute__ ((malloc));
+void kmem_cache_free (struct kmem_cache *, void *);
+
 #endif /* threads/malloc.h */
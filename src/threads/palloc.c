@@ -1,12 +1,13 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -25,12 +26,59 @@
    half to the user pool.  That should be huge overkill for the
    kernel pool, but that's just fine for demonstration purposes. */
 
+/* Each pool is managed as a binary buddy system.  A free block
+   of order K is 2**K pages long and starts at a page index that
+   is a multiple of 2**K.  Free blocks of each order are kept on a
+   separate free list, linked through a list_elem stored in the
+   block's first page.  Allocating takes a block from the
+   smallest nonempty list whose order is large enough, splitting
+   it in halves as needed.  Freeing a block merges it with its
+   "buddy", the other half of the next larger block, for as long
+   as the buddy is also free.  Both operations take O(lg n) time.
+
+   Requests that are not a power of 2 pages are rounded up, and
+   the unused tail is freed again at once, so a caller may free
+   exactly the pages it asked for.  More generally, any range of
+   allocated pages may be freed; it is split into aligned blocks
+   first. */
+
+/* Number of block orders.  The largest block is
+   2**(MAX_ORDER - 1) pages. */
+#define MAX_ORDER 16
+
+/* page_state[] value for the first page of a free block of the
+   given order.  Other pages of a free block have state 0. */
+#define FREE_HEAD 0x80
+
+/* page_state[] value for an allocated page.  Marking every page,
+   not just the first page of each block, lets free_block() catch
+   a page that is freed twice. */
+#define PAGE_USED 0x40
+
+/* Returned by alloc_block() when no block is available. */
+#define NO_BLOCK SIZE_MAX
+
+/* Single-page PAL_ZERO requests are satisfied from a reserve of
+   up to ZEROED_MAX pages per pool that the idle thread fills in
+   advance with palloc_prezero(), so that zeroing a page is not
+   on the latency path of thread creation, process startup, or
+   page faults.  The reserve is also used as a last resort when a
+   pool runs out of free pages. */
+#define ZEROED_MAX 16
+
 /* A memory pool. */
 struct pool
   {
     struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct list free_list[MAX_ORDER];   /* Free blocks of each order. */
+    uint8_t *page_state;                /* State of each page. */
+    size_t page_cnt;                    /* Number of pages. */
     uint8_t *base;                      /* Base of pool. */
+
+    /* Zeroed reserve, protected by disabling interrupts. */
+    void *zeroed[ZEROED_MAX];           /* Allocated, zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of zeroed pages. */
+    size_t zeroing_cnt;                 /* Pages being zeroed. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +87,11 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_block (struct pool *, int order);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void *take_zeroed (struct pool *);
+static bool prezero_pool (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -72,17 +125,37 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
-  size_t page_idx;
+  size_t page_idx = NO_BLOCK;
+  int order;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if (page_cnt == 1 && (flags & PAL_ZERO))
+    {
+      pages = take_zeroed (pool);
+      if (pages != NULL)
+        return pages;
+    }
 
-  if (page_idx != BITMAP_ERROR)
+  for (order = 0; order < MAX_ORDER && ((size_t) 1 << order) < page_cnt;
+       order++)
+    continue;
+
+  if (order < MAX_ORDER)
+    {
+      lock_acquire (&pool->lock);
+      page_idx = alloc_block (pool, order);
+      if (page_idx != NO_BLOCK)
+        free_range (pool, page_idx + page_cnt,
+                    ((size_t) 1 << order) - page_cnt);
+      lock_release (&pool->lock);
+    }
+
+  if (page_idx != NO_BLOCK)
     pages = pool->base + PGSIZE * page_idx;
+  else if (page_cnt == 1)
+    pages = take_zeroed (pool);
   else
     pages = NULL;
 
@@ -132,13 +205,15 @@ palloc_free_multiple (void *pages, size_t page_cnt)
     NOT_REACHED ();
 
   page_idx = pg_no (pages) - pg_no (pool->base);
+  ASSERT (page_idx + page_cnt <= pool->page_cnt);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  lock_acquire (&pool->lock);
+  free_range (pool, page_idx, page_cnt);
+  lock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +223,54 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes one free page ahead of time for a later PAL_ZERO
+   allocation, if either pool's zeroed reserve is not full.
+   Returns true if a page was zeroed, false if there was nothing
+   to do.
+
+   Called by the idle thread with interrupts off.  Never sleeps:
+   a pool whose lock is held is skipped.  Interrupts are turned
+   on while the page is being zeroed, and are off again on
+   return. */
+bool
+palloc_prezero (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return prezero_pool (&kernel_pool) || prezero_pool (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  int order;
+
+  /* We'll put the pool's page_state array at its base.
+     Calculate the space needed for it and subtract it from the
+     pool's size. */
+  size_t state_pages = DIV_ROUND_UP (page_cnt, PGSIZE);
+  if (state_pages > page_cnt)
+    PANIC ("Not enough memory in %s for page state.", name);
+  page_cnt -= state_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  for (order = 0; order < MAX_ORDER; order++)
+    list_init (&p->free_list[order]);
+  p->page_state = base;
+  memset (p->page_state, PAGE_USED, page_cnt);
+  p->page_cnt = page_cnt;
+  p->base = base + state_pages * PGSIZE;
+
+  /* Initially, every page is free. */
+  free_range (p, 0, page_cnt);
+
+  p->zeroed_cnt = 0;
+  p->zeroing_cnt = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +280,159 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Removes and returns a page from POOL's zeroed reserve, or a
+   null pointer if the reserve is empty. */
+static void *
+take_zeroed (struct pool *pool)
+{
+  enum intr_level old_level;
+  void *page = NULL;
+
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt > 0)
+    page = pool->zeroed[--pool->zeroed_cnt];
+  intr_set_level (old_level);
+  return page;
+}
+
+/* Adds a newly zeroed page to POOL's zeroed reserve if it is not
+   full.  Returns true if successful, false if there was nothing
+   to do.  See palloc_prezero(). */
+static bool
+prezero_pool (struct pool *pool)
+{
+  size_t page_idx = NO_BLOCK;
+  void *page;
+  bool full;
+
+  /* Reserve a slot in the zeroed reserve. */
+  full = pool->zeroed_cnt + pool->zeroing_cnt >= ZEROED_MAX;
+  if (!full)
+    pool->zeroing_cnt++;
+  if (full)
+    return false;
+
+  if (lock_try_acquire (&pool->lock))
+    {
+      page_idx = alloc_block (pool, 0);
+      lock_release (&pool->lock);
+    }
+  if (page_idx == NO_BLOCK)
+    {
+      pool->zeroing_cnt--;
+      return false;
+    }
+
+  page = pool->base + PGSIZE * page_idx;
+  intr_enable ();
+  memset (page, 0, PGSIZE);
+  intr_disable ();
+
+  pool->zeroing_cnt--;
+  pool->zeroed[pool->zeroed_cnt++] = page;
+  return true;
+}
+
+/* Returns the list element in the first page of the block at
+   PAGE_IDX in POOL. */
+static struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Removes a free block of 2**ORDER pages from POOL and returns
+   the index of its first page, or NO_BLOCK if no block of
+   that size is available.  POOL's lock must be held. */
+static size_t
+alloc_block (struct pool *pool, int order)
+{
+  size_t page_idx;
+  int k;
+
+  for (k = order; k < MAX_ORDER; k++)
+    if (!list_empty (&pool->free_list[k]))
+      break;
+  if (k >= MAX_ORDER)
+    return NO_BLOCK;
+
+  page_idx = pg_no (list_pop_front (&pool->free_list[k]))
+             - pg_no (pool->base);
+  ASSERT (pool->page_state[page_idx] == (FREE_HEAD | k));
+
+  /* Split off upper halves until the block is the right size. */
+  while (k > order)
+    {
+      size_t buddy;
+
+      k--;
+      buddy = page_idx + ((size_t) 1 << k);
+      pool->page_state[buddy] = FREE_HEAD | k;
+      list_push_front (&pool->free_list[k], block_elem (pool, buddy));
+    }
+  memset (pool->page_state + page_idx, PAGE_USED, (size_t) 1 << order);
+  return page_idx;
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX to POOL's free
+   lists, first merging it with its buddy for as long as the
+   buddy is free.  POOL's lock must be held. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  size_t page_cnt = (size_t) 1 << order;
+  size_t i;
+
+  ASSERT (order >= 0 && order < MAX_ORDER);
+  ASSERT (page_idx % page_cnt == 0);
+  ASSERT (page_idx + page_cnt <= pool->page_cnt);
+
+  /* Every page in the block must be allocated. */
+  for (i = 0; i < page_cnt; i++)
+    ASSERT (pool->page_state[page_idx + i] == PAGE_USED);
+  memset (pool->page_state + page_idx, 0, page_cnt);
+
+  while (order < MAX_ORDER - 1)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy + ((size_t) 1 << order) > pool->page_cnt
+          || pool->page_state[buddy] != (FREE_HEAD | order))
+        break;
+
+      list_remove (block_elem (pool, buddy));
+      pool->page_state[buddy] = 0;
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+    }
+
+  pool->page_state[page_idx] = FREE_HEAD | order;
+  list_push_front (&pool->free_list[order], block_elem (pool, page_idx));
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in POOL, which
+   need not form a single block, by splitting them into the
+   largest aligned blocks possible.  POOL's lock must be held. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order < MAX_ORDER - 1
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
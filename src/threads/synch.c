@@ -32,6 +32,11 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+static heap_less_func sema_waiter_less;
+static heap_less_func cond_waiter_less;
+static int sema_max_priority (struct semaphore *);
+static void lock_set_holder (struct lock *);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -47,7 +52,8 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, sema_waiter_less, NULL);
+  sema->next_seq = 0;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -68,8 +74,11 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      // list_push_back (&sema->waiters, &thread_current ()->elem);
-      list_insert_ordered (&sema->waiters, &thread_current ()->elem, cmp_priority, NULL);
+      /* 우선 순위가 가장 높은 스레드가 top에 오도록 waiters heap에 삽입 */
+      struct thread *cur = thread_current ();
+      cur->wait_seq = sema->next_seq++;
+      cur->wait_sema = sema;
+      heap_push (&sema->waiters, &cur->wait_elem);
       thread_block ();
     }
   sema->value--;
@@ -114,11 +123,13 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) {
-    /* 스레드가 waiters list에 있는 동안 우선 순위가 변경 되었을 경우를 고려하여 우선 순위로 정렬 */
-    list_sort (&sema->waiters, cmp_priority, NULL);
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+  if (!heap_empty (&sema->waiters)) {
+    /* 대기 중 우선 순위가 바뀐 스레드는 synch_set_waiter_priority()가
+     * heap 내 위치를 갱신하므로 top이 항상 우선 순위가 가장 높은 스레드이다 */
+    struct thread *t = heap_entry (heap_pop (&sema->waiters),
+                                   struct thread, wait_elem);
+    t->wait_sema = NULL;
+    thread_unblock (t);
   }
   sema->value++;
 
@@ -187,6 +198,7 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->priority = PRI_MIN - 1;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -210,22 +222,15 @@ lock_acquire (struct lock *lock)
   if (!get_thread_mlfqs () && lock->holder != NULL) {
     /* 현재 스레드의 wait_on_lock 변수에 획득 하기를 기다리는 lock의 주소를 저장 */
     thread_current ()->wait_on_lock = lock;
-    /* multiple donation을 고려하기 위해 이전 상태의 우선 순위를 기억, 
-     * donation을 받은 스레드의 구조체를 list로 관리한다. */
-    struct thread *holder = lock->holder;
-
-    if (holder->priority < thread_current ()->priority)
-    {
-      holder->priority = thread_current ()->priority;
-      list_insert_ordered (&holder->donations, &thread_current ()->donation_elem, cmp_priority, NULL);
-    }
-    /* priority donation을 수행하기 위해 donate_priority () 함수 호출 */
+    /* lock의 우선 순위를 올려 holder에게 기부하고, chain을 따라 전파한다.
+     * lock을 기다리는 스레드들은 semaphore의 waiters heap에 들어가므로
+     * 따로 donation 리스트를 관리하지 않는다. */
     donate_priority ();
   }
 
   sema_down (&lock->semaphore);
   /* lock을 획득 한 후 lock holder를 갱신한다. */
-  lock->holder = thread_current ();
+  lock_set_holder (lock);
 
   thread_current ()->wait_on_lock = NULL;
 
@@ -248,7 +253,11 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = intr_disable ();
+      lock_set_holder (lock);
+      intr_set_level (old_level);
+    }
   return success;
 }
 
@@ -263,15 +272,34 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  enum intr_level old_level = intr_disable ();
   lock->holder = NULL;
-  if (!get_thread_mlfqs ()) {
-    remove_with_lock (lock);
+  remove_with_lock (lock);
+  if (!get_thread_mlfqs ())
     refresh_priority ();
-  }
+  intr_set_level (old_level);
 
   sema_up (&lock->semaphore);
 }
 
+/* Makes the current thread the holder of LOCK, which it has just
+   acquired.  The threads still waiting for LOCK now donate
+   their priority to the current thread.  Interrupts must be
+   off. */
+static void
+lock_set_holder (struct lock *lock)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lock->holder = cur;
+  lock->priority = sema_max_priority (&lock->semaphore);
+  heap_push (&cur->held_locks, &lock->elem);
+  if (!get_thread_mlfqs () && lock->priority > cur->priority)
+    thread_update_priority (cur, lock->priority);
+}
+
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
    a lock would be racy.) */
@@ -283,11 +311,14 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's wait queue. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct heap_elem elem;              /* Heap element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
+    struct condition *cond;             /* Condition being waited for. */
+    unsigned seq;                       /* Arrival number. */
   };
 
 /* Initializes condition variable COND.  A condition variable
@@ -298,7 +329,8 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_waiter_less, NULL);
+  cond->next_seq = 0;
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -325,6 +357,7 @@ void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -332,9 +365,14 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  /* condition variable의 waiters list에 우선 순위 순서로 삽입되도록 수정 */
-  list_insert_ordered (&cond->waiters, &waiter.elem, cmp_sem_priority, NULL);
-  // list_push_back (&cond->waiters, &waiter.elem);
+  waiter.thread = thread_current ();
+  waiter.cond = cond;
+  /* condition variable의 waiters heap에 우선 순위 순서로 삽입되도록 수정 */
+  old_level = intr_disable ();
+  waiter.seq = cond->next_seq++;
+  heap_push (&cond->waiters, &waiter.elem);
+  waiter.thread->cond_waiter = &waiter;
+  intr_set_level (old_level);
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
@@ -350,17 +388,25 @@ cond_wait (struct condition *cond, struct lock *lock)
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) 
 {
+  struct semaphore_elem *waiter = NULL;
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) {
-    /* condition variable의 waiters list를 우선 순위로 재 정열 */
-    list_sort (&cond->waiters, cmp_sem_priority, NULL);
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  /* waiters heap의 top이 우선 순위가 가장 높은 waiter이다 */
+  old_level = intr_disable ();
+  if (!heap_empty (&cond->waiters)) {
+    waiter = heap_entry (heap_pop (&cond->waiters),
+                         struct semaphore_elem, elem);
+    waiter->thread->cond_waiter = NULL;
   }
+  intr_set_level (old_level);
+
+  if (waiter != NULL)
+    sema_up (&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -375,29 +421,87 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
-bool
-cmp_sem_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+/* Moves ELEM within HEAP after the priority of the thread it
+   stands for changed, RAISED indicating the direction. */
+static void
+requeue_waiter (struct heap *heap, struct heap_elem *elem, bool raised)
 {
-  struct semaphore_elem *s_elt_a = list_entry(a, struct semaphore_elem, elem);
-  struct semaphore_elem *s_elt_b = list_entry(b, struct semaphore_elem, elem);
+  if (raised)
+    heap_decrease (heap, elem);
+  else
+    heap_update (heap, elem);
+}
 
-  // TODO : 먼저 semaphore_elem 으로부터 semaphore를 가져오고
-  // a, b 각각의 waiters를 가져온다.
-  struct semaphore sa = s_elt_a->semaphore;
-  struct semaphore sb = s_elt_b->semaphore;
+/* Sets T's priority to NEW_PRIORITY and moves T to its new
+   position in the semaphore and condition variable wait queues
+   it is in, if any, so that it is still woken in priority order.
 
-  struct list_elem *elt_a = list_front (&sa.waiters);
-  struct list_elem *elt_b = list_front (&sb.waiters);
-  
-  struct thread *a_thread = list_entry (elt_a, struct thread, elem);
-  struct thread *b_thread = list_entry (elt_b, struct thread, elem);
+   A thread is in a condition variable's queue from the start of
+   cond_wait(), before it blocks, so T may also be ready or
+   running.  Moving T within the run queue is left to the caller,
+   thread_update_priority().  Interrupts must be off. */
+void
+synch_set_waiter_priority (struct thread *t, int new_priority)
+{
+  bool raised = new_priority > t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->priority = new_priority;
+  if (t->wait_sema != NULL)
+    requeue_waiter (&t->wait_sema->waiters, &t->wait_elem, raised);
+  if (t->cond_waiter != NULL)
+    requeue_waiter (&t->cond_waiter->cond->waiters, &t->cond_waiter->elem,
+                    raised);
+}
+
+/* Returns the priority of the highest-priority thread waiting
+   on SEMA, or PRI_MIN - 1 if there is none. */
+static int
+sema_max_priority (struct semaphore *sema)
+{
+  enum intr_level old_level;
+  int priority = PRI_MIN - 1;
+
+  old_level = intr_disable ();
+  if (!heap_empty (&sema->waiters))
+    priority = heap_entry (heap_top (&sema->waiters),
+                           struct thread, wait_elem)->priority;
+  intr_set_level (old_level);
+  return priority;
+}
+
+/* Orders semaphore waiters by priority, highest first, and then
+   by arrival. */
+static bool
+sema_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, wait_elem);
+  const struct thread *b = heap_entry (b_, struct thread, wait_elem);
+
+  if (a->priority != b->priority)
+    return a->priority > b->priority;
+  return (int) (a->wait_seq - b->wait_seq) < 0;
+}
+
+/* Orders condition variable waiters by the priority of the
+   waiting thread, highest first, and then by arrival. */
+static bool
+cond_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct semaphore_elem *a
+    = heap_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b
+    = heap_entry (b_, struct semaphore_elem, elem);
+
+  if (a->thread->priority != b->thread->priority)
+    return a->thread->priority > b->thread->priority;
+  return (int) (a->seq - b->seq) < 0;
+}
 
-  if (a_thread->priority > b_thread->priority) {
-    return true;
-  }
-  return false;
-}
\ No newline at end of file
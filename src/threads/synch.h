@@ -1,14 +1,23 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
-/* A counting semaphore. */
+struct thread;
+
+/* A counting semaphore.
+
+   Waiting threads are kept in a max-heap on priority, so that
+   sema_up() wakes the highest-priority waiter in O(lg n) time
+   without sorting.  Threads of equal priority are woken in the
+   order they started waiting. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Heap of waiting threads. */
+    unsigned next_seq;          /* Arrival number of next waiter. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -22,6 +31,9 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct heap_elem elem;      /* Element in holder's held_locks. */
+    int priority;               /* Highest priority donated by waiters,
+                                   or PRI_MIN - 1 if none. */
   };
 
 void lock_init (struct lock *);
@@ -30,10 +42,12 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
-/* Condition variable. */
+/* Condition variable.  Like a semaphore, waiters are kept in a
+   max-heap on priority. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Heap of semaphore_elems. */
+    unsigned next_seq;          /* Arrival number of next waiter. */
   };
 
 void cond_init (struct condition *);
@@ -41,7 +55,7 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-bool cmp_sem_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
+void synch_set_waiter_priority (struct thread *, int new_priority);
 
 /* Optimization barrier.
 
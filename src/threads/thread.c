@@ -11,6 +11,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -29,19 +30,53 @@
 int load_avg; /* 최근 1분 동안 수행 가능한 프로세스의 평균 개수 / 시스템 내 READY 상태 Thread 개수의 평균
                * fixed point 값으로 처리함 */
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* MLFQS recent_cpu decay is applied lazily.  Once per second the
+   decay coefficient (2 * load_avg) / (2 * load_avg + 1) for that
+   second is recorded in decay_coef[] and decay_epoch is
+   incremented.  A thread whose recent_cpu_epoch lags behind
+   decay_epoch has the missed decays applied when it is next
+   examined: when it is unblocked, when it runs, or when the
+   incremental sweep in mlfqs_sweep() reaches it.
+
+   Only the last DECAY_HISTORY coefficients are kept.  A thread
+   that has been blocked for longer than that is decayed with the
+   oldest coefficient still on record for the remaining seconds,
+   at most DECAY_HISTORY more times, by which point its
+   recent_cpu is close to its steady-state value anyway. */
+#define DECAY_HISTORY 64
+static int decay_coef[DECAY_HISTORY];
+static int decay_epoch;
+
+/* Number of threads whose recent_cpu and priority mlfqs_sweep()
+   brings up to date at each timer tick. */
+#define SWEEP_BATCH 8
+
+/* Next element of all_list for mlfqs_sweep() to visit. */
+static struct list_elem *sweep_cursor;
+
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+
+   There is one FIFO list per priority level.  Bit (PRI_MAX - P)
+   of ready_bitmap is set if and only if ready_list[P] is
+   nonempty, so that the highest-priority nonempty list is found
+   with a single `bsf' instruction.  ready_cnt is the total number
+   of threads in all of the lists. */
+#if PRI_MAX - PRI_MIN + 1 > 64
+#error ready_bitmap requires at most 64 priority levels
+#endif
+static struct list ready_list[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Alarm system call : THREAD_BLOCKED 상태의 스레드를 관리하기 위한 리스트 자료 구조 추가 */
-static struct list sleep_list;
-
-/* sleep_list 에서 대기중인 스레드들의 wakeup_tick 값 중 최소값 */
-static int64_t next_tick_to_awake;
+/* Alarm system call : THREAD_BLOCKED 상태의 스레드를 관리하기 위한 sleep queue.
+   wakeup_tick이 가장 작은 스레드가 top에 오는 min-heap이므로
+   삽입과 깨우기가 모두 O(lg n)이다. */
+static struct heap sleep_queue;
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -52,6 +87,25 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Cache of free pages for struct thread and fd tables.
+
+   Creating and destroying threads is frequent, so up to
+   PAGE_CACHE_MAX pages released by dead threads are kept here
+   instead of being returned to the page allocator.  A recycled
+   page is not zeroed: init_thread() clears the struct thread
+   header, and the rest of the page is stack. */
+#define PAGE_CACHE_MAX 16
+static void *page_cache[PAGE_CACHE_MAX];
+static size_t page_cache_cnt;
+
+/* Threads that have died and are no longer referenced, waiting
+   for thread_reap() to free their pages.  A dying thread cannot
+   free its own page while running on it, and
+   thread_schedule_tail() runs with interrupts off, where the page
+   allocator's lock may not be taken, so the pages are freed later
+   in thread context. */
+static struct list reap_list;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -85,6 +139,17 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void *page_alloc (void);
+static void page_release (void *);
+static void thread_put (struct thread *);
+static void thread_reap (void);
+static void ready_list_push (struct thread *);
+static void ready_list_remove (struct thread *);
+static int ready_list_max_priority (void);
+static bool cmp_wakeup_tick (const struct heap_elem *, const struct heap_elem *,
+                             void *aux);
+static bool cmp_lock_priority (const struct heap_elem *,
+                               const struct heap_elem *, void *aux);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -102,12 +167,19 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int pri;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init (&ready_list[pri]);
+  ready_bitmap = 0;
+  ready_cnt = 0;
   list_init (&all_list);
-  list_init (&sleep_list);
+  list_init (&reap_list);
+  sweep_cursor = list_end (&all_list);
+  heap_init (&sleep_queue, cmp_wakeup_tick, NULL);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -193,13 +265,17 @@ thread_create (const char *name, int priority,
 
   ASSERT (function != NULL);
 
+  /* Return the pages of threads that have died to the cache. */
+  thread_reap ();
+
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = page_alloc ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
+  t->ref_cnt = 1;
   tid = t->tid = allocate_tid ();
 
   /* Prepare thread for first run by initializing its stack.
@@ -234,13 +310,24 @@ thread_create (const char *name, int priority,
   sema_init (&t->load_sema, 0);
   /* exit semaphore 0으로 초기화 */
   sema_init (&t->exit_sema, 0);
-  /* 자식 리스트에 추가 */
+#ifdef USERPROG
+  /* 자식 리스트에 추가. 자식을 리스트에서 빼는 것은 process_wait()와
+     process_exit()뿐이므로 USERPROG에서만 연결한다 */
   list_push_back (&t->parent->children, &t->child);
+  /* 부모가 process_wait()으로 종료 상태를 회수하거나 종료할 때까지
+     스레드 페이지를 해제하지 않도록 부모도 참조를 갖는다 */
+  t->ref_cnt++;
+#endif
 
   /* fd 값 초기화 - 0, 1은 표준 입출력 */
   t->fd_size = 2;
   /* fd 테이블에 메모리 할당 */
-  t->fd_table = palloc_get_page (0);
+  t->fd_table = page_alloc ();
+  /* 재사용된 페이지에는 이전 프로세스의 파일 포인터가 남아 있으므로
+   * 사용 중인 fd 범위만 비운다. fd_size 이상의 칸은
+   * process_add_file()이 먼저 채운 뒤에 읽힌다 */
+  if (t->fd_table != NULL)
+    memset (t->fd_table, 0, t->fd_size * sizeof *t->fd_table);
 
   /* Add to run queue. */
   thread_unblock (t);
@@ -289,10 +376,15 @@ thread_unblock (struct thread *t)
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
 
-  /* 우선 순위 순으로 정렬되어 ready_list에 삽입되도록 수정 */
-  list_insert_ordered (&ready_list, &t->elem, cmp_priority, NULL);
-  // list_push_back (&ready_list, &t->elem);
+  /* 블록된 동안 밀린 recent_cpu decay를 반영하고 우선 순위를 다시 계산 */
+  if (thread_mlfqs && t->recent_cpu_epoch != decay_epoch)
+    {
+      mlfqs_recent_cpu (t);
+      mlfqs_priority (t);
+    }
 
+  /* 우선 순위에 해당하는 ready_list의 끝에 삽입 */
+  ready_list_push (t);
   t->status = THREAD_READY;
   intr_set_level (old_level);
 }
@@ -345,6 +437,8 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (sweep_cursor == &thread_current ()->allelem)
+    sweep_cursor = list_next (sweep_cursor);
   list_remove (&thread_current ()->allelem);
 
   /* 프로세스 디스크립터에 프로세스 종료를 알림 */
@@ -371,8 +465,7 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_insert_ordered (&ready_list, &cur->elem, cmp_priority, NULL);
-    // list_push_back (&ready_list, &cur->elem);
+    ready_list_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -413,7 +506,7 @@ thread_set_priority (int new_priority)
     //Compare old priority and current priority and if not same, do something.
     if (old_priority < cur->priority)
     {
-      donate_priority(); //현재 스레드가 donations 리스트에서 기부받았다는 이야기! nested donation 실행
+      donate_priority(); //현재 스레드가 기다리는 lock이 있다면 nested donation 실행
     }
     else if (old_priority > cur->priority)
     {
@@ -437,6 +530,9 @@ thread_set_nice (int nice)
   enum intr_level old_level = intr_disable ();
 
   struct thread *cur = thread_current ();
+
+  /* 지난 decay는 이전 nice 값으로 반영한 뒤 변경한다. */
+  mlfqs_recent_cpu (cur);
   cur->nice = nice;
 
    /* nice값 변경 후에 현재 스레드의 우선 순위를 재계산하고 우선순위에 의해 스케줄링 한다. */
@@ -471,6 +567,7 @@ int
 thread_get_recent_cpu (void) 
 {
   enum intr_level old_level = intr_disable ();
+  mlfqs_recent_cpu (thread_current ());
   int current_recent = fp_to_int_round (mult_mixed (thread_current ()->recent_cpu, 100));
   intr_set_level (old_level);
   return current_recent;
@@ -498,6 +595,15 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nobody else wants to run, so zero a page ahead of time
+         for a later PAL_ZERO allocation, then check again. */
+      if (palloc_prezero ())
+        continue;
+
+      /* In dynamic-tick mode, stop the timer from interrupting
+         at every tick while we are halted. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -568,11 +674,12 @@ init_thread (struct thread *t, const char *name, int priority)
 
   /* priority donation 관련 자료구조 초기화 */
   t->init_priority = priority;
-  list_init(&t->donations); /* multiple donation을 고려하기 위해 사용 */
+  heap_init (&t->held_locks, cmp_lock_priority, NULL); /* multiple donation을 고려하기 위해 사용 */
 
   /* Multi-level feedback queue */
   t->nice = NICE_DEFAULT;
   t->recent_cpu = RECENT_CPU_DEFAULT;
+  t->recent_cpu_epoch = decay_epoch;
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -596,10 +703,96 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  int pri = ready_list_max_priority ();
+  struct thread *t;
+
+  if (pri < PRI_MIN)
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+  t = list_entry (list_front (&ready_list[pri]), struct thread, elem);
+  ready_list_remove (t);
+  return t;
+}
+
+/* Appends T to the run queue list for its priority.  Interrupts
+   must be off. */
+static void
+ready_list_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  list_push_back (&ready_list[t->priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << (PRI_MAX - t->priority);
+  ready_cnt++;
+}
+
+/* Removes T, which must be in the run queue, from its priority's
+   list.  Interrupts must be off. */
+static void
+ready_list_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_list[t->priority]))
+    ready_bitmap &= ~((uint64_t) 1 << (PRI_MAX - t->priority));
+  ready_cnt--;
+}
+
+/* Returns the priority of the highest-priority thread in the run
+   queue, or PRI_MIN - 1 if the run queue is empty. */
+static int
+ready_list_max_priority (void)
+{
+  uint32_t lo = ready_bitmap;
+  uint32_t hi = ready_bitmap >> 32;
+  uint32_t bit;
+
+  if (lo != 0)
+    {
+      asm ("bsfl %1, %0" : "=r" (bit) : "rm" (lo));
+      return PRI_MAX - (int) bit;
+    }
+  if (hi != 0)
+    {
+      asm ("bsfl %1, %0" : "=r" (bit) : "rm" (hi));
+      return PRI_MAX - (int) (bit + 32);
+    }
+  return PRI_MIN - 1;
+}
+
+/* Sets T's priority to NEW_PRIORITY.  If T is in the run queue,
+   it is moved to the back of the list for its new priority, and
+   if T is waiting on a semaphore or condition variable, it is
+   moved to its new position in the wait queue.
+   This does not preempt the running thread; use
+   test_max_priority() for that. */
+void
+thread_update_priority (struct thread *t, int new_priority)
+{
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  /* synch_set_waiter_priority() sets the priority, also moving T
+     within any wait queue it is in.  A thread that has queued on
+     a condition variable but not yet blocked may be ready, so it
+     must move within the run queue as well. */
+  old_level = intr_disable ();
+  if (t->priority != new_priority)
+    {
+      if (t->status == THREAD_READY && t != idle_thread)
+        {
+          ready_list_remove (t);
+          synch_set_waiter_priority (t, new_priority);
+          ready_list_push (t);
+        }
+      else
+        synch_set_waiter_priority (t, new_priority);
+    }
+  intr_set_level (old_level);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -636,16 +829,111 @@ thread_schedule_tail (struct thread *prev)
   process_activate ();
 #endif
 
-  /* If the thread we switched from is dying, destroy its struct
-     thread.  This must happen late so that thread_exit() doesn't
-     pull out the rug under itself.  (We don't free
-     initial_thread because its memory was not obtained via
-     palloc().) */
+  /* If the thread we switched from is dying, drop its reference
+     to its struct thread, which is destroyed by thread_reap() once
+     its parent no longer needs it either.  This must happen late
+     so that thread_exit() doesn't pull out the rug under itself.
+     (We don't free initial_thread because its memory was not
+     obtained via palloc().) */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      // palloc_free_page (prev);
+      thread_put (prev);
+    }
+}
+
+/* Drops the reference to T held by its parent, which has
+   collected T's exit status or is exiting itself, and frees any
+   threads that are no longer referenced.  T must already have
+   been removed from its parent's list of children. */
+void
+thread_release (struct thread *t)
+{
+  ASSERT (is_thread (t));
+  ASSERT (!intr_context ());
+
+  thread_put (t);
+  thread_reap ();
+}
+
+/* Drops a reference to T.  T is queued for thread_reap() when
+   both T itself has died and switched out and its parent has
+   released it. */
+static void
+thread_put (struct thread *t)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  ASSERT (t->ref_cnt > 0);
+  if (--t->ref_cnt == 0)
+    {
+      ASSERT (t->status == THREAD_DYING);
+      list_push_back (&reap_list, &t->elem);
+    }
+  intr_set_level (old_level);
+}
+
+/* Frees the thread pages and fd tables of the threads on
+   reap_list. */
+static void
+thread_reap (void)
+{
+  for (;;)
+    {
+      struct thread *t = NULL;
+      enum intr_level old_level;
+
+      old_level = intr_disable ();
+      if (!list_empty (&reap_list))
+        t = list_entry (list_pop_front (&reap_list), struct thread, elem);
+      intr_set_level (old_level);
+      if (t == NULL)
+        break;
+
+      if (t->fd_table != NULL)
+        page_release (t->fd_table);
+      t->magic = 0;
+      page_release (t);
+    }
+}
+
+/* Returns a page from the page cache, or a new page from the
+   page allocator if the cache is empty.  Returns a null pointer
+   if no page is available.  The page's contents are
+   unspecified. */
+static void *
+page_alloc (void)
+{
+  void *page = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (page_cache_cnt > 0)
+    page = page_cache[--page_cache_cnt];
+  intr_set_level (old_level);
+
+  return page != NULL ? page : palloc_get_page (0);
+}
+
+/* Puts PAGE, obtained from page_alloc(), into the page cache, or
+   returns it to the page allocator if the cache is full. */
+static void
+page_release (void *page)
+{
+  enum intr_level old_level;
+  bool cached = false;
+
+  old_level = intr_disable ();
+  if (page_cache_cnt < PAGE_CACHE_MAX)
+    {
+      page_cache[page_cache_cnt++] = page;
+      cached = true;
     }
+  intr_set_level (old_level);
+
+  if (!cached)
+    palloc_free_page (page);
 }
 
 /* Schedules a new process.  At entry, interrupts must be off and
@@ -667,7 +955,13 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      /* Restore the periodic timer that timer_idle_enter() may
+         have stopped. */
+      if (cur == idle_thread)
+        timer_idle_exit ();
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -698,62 +992,62 @@ void thread_sleep (int64_t ticks)
 
   ASSERT (cur != idle_thread);
   cur->wakeup_tick = ticks;
-  /* awake 함수가 실행되어야 할 tick 값을 update */
-  update_next_tick_to_awake (ticks);
 
-  list_push_back(&sleep_list, &cur->elem);
+  heap_push (&sleep_queue, &cur->sleep_elem);
   thread_block ();
 
   intr_set_level (old_level);
 }
 
+/* wakeup_tick이 TICKS 이하인 스레드들을 sleep queue에서 꺼내 unblock 한다.
+ * 깨어나는 스레드 수에 비례하는 시간만 걸린다. */
 void thread_awake (int64_t ticks)
 {
-  struct list_elem *e;
-  for (e = list_begin (&sleep_list); e != list_end (&sleep_list);)
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!heap_empty (&sleep_queue))
     {
-      struct thread *t = list_entry(e, struct thread, elem);
-      if (t->wakeup_tick <= ticks)
-        {
-          /* 슬립 큐에서 제거하고 unblock 한다 */
-          e = list_remove (e);
-          thread_unblock (t);
-        }
-      else
-        {
-          update_next_tick_to_awake (ticks);
-          e = list_next (e);
-        }
+      struct thread *t = heap_entry (heap_top (&sleep_queue),
+                                     struct thread, sleep_elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      heap_pop (&sleep_queue);
+      thread_unblock (t);
     }
 }
 
-void update_next_tick_to_awake (int64_t ticks)
+int64_t get_next_tick_to_awake ()
 {
-  /* next_tick_to_awake 가 깨워야할 스레드 중 가장 작은 tick을 갖도록 업데이트 */
-  if (next_tick_to_awake > ticks)
-  {
-    next_tick_to_awake = ticks;
-  }
+  /* sleep queue의 top이 가장 먼저 깨어나야 할 스레드이다.
+   * 자고 있는 스레드가 없으면 INT64_MAX를 반환한다. */
+  if (heap_empty (&sleep_queue))
+    return INT64_MAX;
+  return heap_entry (heap_top (&sleep_queue), struct thread,
+                     sleep_elem)->wakeup_tick;
 }
 
-int64_t get_next_tick_to_awake ()
+/* Orders the sleep queue by wakeup_tick, earliest first. */
+static bool
+cmp_wakeup_tick (const struct heap_elem *a_, const struct heap_elem *b_,
+                 void *aux UNUSED)
 {
-  /* next_tick_to_awake를 반환한다 */
-  return next_tick_to_awake;
+  const struct thread *a = heap_entry (a_, struct thread, sleep_elem);
+  const struct thread *b = heap_entry (b_, struct thread, sleep_elem);
+
+  return a->wakeup_tick < b->wakeup_tick;
 }
 
 void test_max_priority ()
 {
-  /* ready_list에서 우선순위가 가장 높은 스레드와 현재 스레드의 우선순위를 비교하여 스케줄링 한다. */
-  /* ready_list가 비어있지 않은지 확인한다. */
-  if (list_empty (&ready_list) == true)
+  /* ready_list에서 우선순위가 가장 높은 스레드와 현재 스레드의 우선순위를 비교하여 스케줄링 한다.
+   * ready_list가 비어 있으면 PRI_MIN - 1이 반환되므로 양보하지 않는다. */
+  if (ready_list_max_priority () > thread_current ()->priority)
   {
-    return;
-  }
-  struct thread *t = list_entry (list_front(&ready_list), struct thread, elem);
-  if (t->priority > thread_current ()->priority)
-  {
-    thread_yield ();
+    /* 인터럽트 핸들러에서 (예: sema_up) 호출된 경우에는 핸들러가 끝난 뒤 양보한다. */
+    if (intr_context ())
+      intr_yield_on_return ();
+    else
+      thread_yield ();
   }
 }
 
@@ -773,66 +1067,66 @@ void
 donate_priority ()
 {
   /* priority donation을 수행하는 함수. 
-   * 현재 스레드가 기다리고 있는 lock과 연결된 모든 스레드들을 순회하며
-   * 현재 스레드의 우선 순위를 lock을 보유하고 있는 스레드에게 기부한다.
-   * (nested depth는 8로 제한한다) 
-   * nested donation일 때만 따지는 이유는 / donations를 multiple 일때만 따지는 이유는
-   * 이미 lock을 기다리는 스레드의 우선순위가 thread_current()로 인해 변해있기 때문이지..! */
-
-  int priority_of_current = thread_current ()->priority;
-  struct lock *lock_waited = thread_current ()->wait_on_lock;
-  struct thread *holder;
-  int i = 0;
-
-  for (i = 0; i < 8; i++)
-  {
-    if (lock_waited == NULL)
-      break;
+   * 현재 스레드가 기다리고 있는 lock의 우선 순위(그 lock을 기다리는 스레드 중 가장
+   * 높은 우선 순위)를 올리고, holder의 held_locks heap에서 위치를 갱신한 뒤
+   * holder의 우선 순위에 반영한다. holder가 다시 다른 lock을 기다리고 있으면
+   * chain의 끝까지 반복한다. (nested depth 제한 없음)
+   * 어떤 lock의 우선 순위가 더 오르지 않으면 그 뒤의 스레드들도 바뀌지 않으므로 멈춘다. */
+  struct thread *t = thread_current ();
+  struct lock *lock = t->wait_on_lock;
 
-    if (lock_waited->holder == NULL || lock_waited->holder->priority > priority_of_current)
-      break;
+  ASSERT (intr_get_level () == INTR_OFF);
 
-    lock_waited->holder->priority = priority_of_current;
+  while (lock != NULL && lock->holder != NULL && lock->priority < t->priority)
+    {
+      struct thread *holder = lock->holder;
 
-    holder = lock_waited->holder;
-    lock_waited = holder->wait_on_lock;
-  }
+      lock->priority = t->priority;
+      heap_decrease (&holder->held_locks, &lock->elem);
+      if (holder->priority < lock->priority)
+        thread_update_priority (holder, lock->priority);
+
+      t = holder;
+      lock = holder->wait_on_lock;
+    }
 }
 
 void
 remove_with_lock (struct lock *lock)
 {
-  struct thread *cur = thread_current ();
-  struct list_elem *e;
-
-  if (list_empty(&cur->donations))
-    return;
-
-  for (e = list_begin (&cur->donations); e != list_end (&cur->donations);)
-  {
-    struct thread *t = list_entry (e, struct thread, donation_elem);
-    e = list_next (e);
-    if (t->wait_on_lock == lock)
-    {
-      list_remove (&t->donation_elem);
-    }
-  }
+  /* 해제한 lock을 held_locks heap에서 삭제하면 그 lock을 기다리던 스레드들의
+   * donation도 함께 사라진다. */
+  heap_remove (&thread_current ()->held_locks, &lock->elem);
 }
 
 void
 refresh_priority ()
 {
   struct thread *cur = thread_current ();
-  cur->priority = cur->init_priority; // ☆처음 우선 순위를 기억한다는게 이런 건가요..!
+  int new_priority = cur->init_priority; // ☆처음 우선 순위를 기억한다는게 이런 건가요..!
 
-  if (list_empty (&cur->donations)) 
-    return;
+  /* held_locks heap의 top이 가장 높은 우선 순위를 기부받은 lock이다. */
+  if (!heap_empty (&cur->held_locks)) 
+    {
+      struct lock *lock = heap_entry (heap_top (&cur->held_locks),
+                                      struct lock, elem);
 
-  struct list_elem *donor_elem = list_front (&cur->donations);
-  struct thread *donor = list_entry (donor_elem, struct thread, donation_elem);
+      if (lock->priority > new_priority)
+        new_priority = lock->priority;
+    }
+  thread_update_priority (cur, new_priority);
+}
+
+/* Orders a thread's held locks by the highest priority among
+   their waiters, highest first. */
+static bool
+cmp_lock_priority (const struct heap_elem *a_, const struct heap_elem *b_,
+                   void *aux UNUSED)
+{
+  const struct lock *a = heap_entry (a_, struct lock, elem);
+  const struct lock *b = heap_entry (b_, struct lock, elem);
 
-  if (donor->priority > cur->init_priority)
-    cur->priority = donor->priority;
+  return a->priority > b->priority;
 }
 
 /* 10. Multi-level feeback queue 
@@ -851,15 +1145,21 @@ mlfqs_priority (struct thread *t)
 
   // priority = PRI_MAX - (recent_cpu / 4) - (nice * 2) 
   int new_priority_f = sub_fp (max_priority, to_sub_f);
-  t->priority = fp_to_int (new_priority_f);
+  int new_priority = fp_to_int (new_priority_f);
 
   /* 범위 외 값 처리도 해야 했다!*/
-  if (t->priority > PRI_MAX) 
-    t->priority = PRI_MAX;
-  if (t->priority < PRI_MIN)
-    t->priority = PRI_MIN;
+  if (new_priority > PRI_MAX) 
+    new_priority = PRI_MAX;
+  if (new_priority < PRI_MIN)
+    new_priority = PRI_MIN;
+
+  /* READY 상태라면 새 우선 순위의 ready_list로 옮겨진다. */
+  thread_update_priority (t, new_priority);
 }
 
+/* t의 recent_cpu에 마지막으로 계산된 이후 밀린 decay를 모두 반영한다.
+ * recent_cpu = (2 * load_avg) / (2 * load_avg + 1) * recent_cpu + nice 를
+ * 밀린 초마다, 그 초의 load_avg로 적용한다. */
 void
 mlfqs_recent_cpu (struct thread *t)
 {
@@ -867,22 +1167,38 @@ mlfqs_recent_cpu (struct thread *t)
   if (t == idle_thread)
     return;
 
-  int load_avg_to_cal = mult_mixed (load_avg, 2);
-  load_avg_to_cal = div_fp (load_avg_to_cal, add_mixed (load_avg_to_cal, 1));
-  int temp_cpu = mult_fp (load_avg_to_cal, t->recent_cpu);
+  int behind = decay_epoch - t->recent_cpu_epoch;
+  int epoch = t->recent_cpu_epoch + 1;
 
-  /* recent_cpu = (2 * load_avg) / (2 * load_avg + 1) * recent_cpu + nice */
-  t->recent_cpu = add_mixed (temp_cpu, t->nice);
+  /* 기록이 남아 있지 않은 오래된 초는 가장 오래된 계수로 근사한다. */
+  if (behind > DECAY_HISTORY)
+    {
+      int excess = behind - DECAY_HISTORY;
+      int oldest = decay_coef[(decay_epoch + 1) % DECAY_HISTORY];
+
+      if (excess > DECAY_HISTORY)
+        excess = DECAY_HISTORY;
+      while (excess-- > 0)
+        t->recent_cpu = add_mixed (mult_fp (oldest, t->recent_cpu), t->nice);
+      epoch = decay_epoch - DECAY_HISTORY + 1;
+    }
+
+  for (; epoch <= decay_epoch; epoch++)
+    {
+      int coef = decay_coef[epoch % DECAY_HISTORY];
+      t->recent_cpu = add_mixed (mult_fp (coef, t->recent_cpu), t->nice);
+    }
+  t->recent_cpu_epoch = decay_epoch;
 }
 
 void
 mlfqs_load_avg () {
   /* Get current amount of threads */
-  int ready_cnt = list_size(&ready_list);
+  int ready_threads = ready_cnt;
   if(thread_current() != idle_thread) /* If not idle thread, increment 1 */
-    ready_cnt += 1;
+    ready_threads += 1;
 
-  int portion_1 = div_mixed (int_to_fp (ready_cnt), 60);
+  int portion_1 = div_mixed (int_to_fp (ready_threads), 60);
   int portion_59 = div_mixed (int_to_fp (59), 60);
   portion_59 = mult_fp (portion_59, load_avg);
 
@@ -898,25 +1214,48 @@ mlfqs_increment ()
     return;
 
   struct thread *cur = thread_current ();
+  /* 이번 초의 증가분이 이전 초의 decay에 섞이지 않도록 먼저 decay를 반영 */
+  mlfqs_recent_cpu (cur);
   cur->recent_cpu = add_mixed (cur->recent_cpu, 1);
 
 }
 
+/* 1초마다 호출된다. 모든 스레드를 순회하는 대신 이번 초의 decay 계수를
+ * 기록해 두고, 실행 중인 스레드만 즉시 갱신한다. 나머지 스레드는
+ * mlfqs_sweep()이나 unblock 될 때 갱신되므로 이 함수는 O(1)이다. */
 void
 mlfqs_recalc ()
 {
-  /* 모든 thread의 recent_cpu와 priority값을 재계산한다.*/
-  // TODO : 인터럽트 처리 해줘야 할까...??????????
-  struct list_elem *e;
+  int load_avg_to_cal = mult_mixed (load_avg, 2);
 
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-       e = list_next (e))
+  decay_epoch++;
+  decay_coef[decay_epoch % DECAY_HISTORY]
+    = div_fp (load_avg_to_cal, add_mixed (load_avg_to_cal, 1));
+
+  mlfqs_recent_cpu (thread_current ());
+  mlfqs_priority (thread_current ());
+
+  /* 새 decay를 반영하기 위해 all_list를 처음부터 다시 훑는다. */
+  sweep_cursor = list_begin (&all_list);
+}
+
+/* 매 tick마다 호출되어 all_list의 스레드를 최대 SWEEP_BATCH개씩
+ * 갱신한다. ready 상태의 스레드도 1초 내에 새 우선 순위를 갖게 된다. */
+void
+mlfqs_sweep ()
+{
+  int i;
+
+  for (i = 0; i < SWEEP_BATCH && sweep_cursor != list_end (&all_list); i++)
     {
-      struct thread *t = list_entry (e, struct thread, allelem);
-      mlfqs_recent_cpu (t);
-      mlfqs_priority (t);
+      struct thread *t = list_entry (sweep_cursor, struct thread, allelem);
+      sweep_cursor = list_next (sweep_cursor);
+      if (t->recent_cpu_epoch != decay_epoch)
+        {
+          mlfqs_recent_cpu (t);
+          mlfqs_priority (t);
+        }
     }
-
 }
 
 bool
@@ -2,9 +2,15 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
 #include "synch.h"
+#ifdef VM
+#include <hashmap.h>
+#endif
+
+struct semaphore_elem;
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -76,11 +82,13 @@ typedef int tid_t;
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   the run queue, or it can be an element in the list of dead
+   threads waiting to be reaped (both thread.c).  It can be used
+   these two ways only because they are mutually exclusive: only
+   a thread in the ready state is on the run queue, whereas only
+   a thread in the dying state is on the reap list.  A thread
+   blocked on a semaphore is in the semaphore's wait queue
+   (synch.c) through `wait_elem' instead. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -91,15 +99,28 @@ struct thread
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
 
-    /* Shared between thread.c and synch.c. */
+    /* Owned by thread.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by synch.c. */
+    struct heap_elem wait_elem;         /* Semaphore wait queue element. */
+    struct semaphore *wait_sema;        /* Semaphore we are waiting on. */
+    unsigned wait_seq;                  /* FIFO order among equal priorities. */
+    struct semaphore_elem *cond_waiter; /* Our condition variable waiter. */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
 #endif
 
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hashmap pages;               /* Supplemental page table. */
+    void *user_esp;                     /* User %esp on syscall entry. */
+#endif
+
     /* Owned by thread.c. */
+    int ref_cnt;                        /* References to this page. */
     unsigned magic;                     /* Detects stack overflow. */
 
     /* 3. 프로세스 계층 구조 ~ */
@@ -118,15 +139,16 @@ struct thread
 
     struct file *run_file;
 
-    int64_t wakeup_tick;
+    int64_t wakeup_tick;                /* 깨어나야 할 tick */
+    struct heap_elem sleep_elem;        /* sleep queue의 heap element */
 
     int init_priority;  /* donation 이후 우선 순위를 초기화하기 위해 초기값 저장 */
     struct lock *wait_on_lock; /* 해당 스레드가 대기하고 있는 lock 자료구조의 주소를 저장 */
-    struct list donations; /* multiple donation을 고려하기 위해 사용 */
-    struct list_elem donation_elem; /* multiple donation을 고려하기 위해 사용 */
+    struct heap held_locks; /* 보유한 lock들 - 기부받은 우선 순위가 가장 높은 lock이 top */
 
     int nice;  /* multi-level feedback queue를 위해 */
     int recent_cpu;  /* 최근에 CPU time을 얼마나 사용했는지 - fixed point 값으로 처리함 */
+    int recent_cpu_epoch;  /* recent_cpu에 마지막으로 decay가 반영된 시점 (초) */
   };
 
 /* If false (default), use round-robin scheduler.
@@ -152,6 +174,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_release (struct thread *);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -167,16 +190,17 @@ int thread_get_load_avg (void);
 
 void thread_sleep(int64_t ticks); /* 실행 중인 스레드를 슬립으로 만듦 */
 void thread_awake(int64_t ticks); /* 슬립큐에서 깨워야할 스레드를 깨움 */
-void update_next_tick_to_awake(int64_t ticks); /* 최소 틱을 가진 스레드 저장 */
-int64_t get_next_tick_to_awake(void); /* thread.c의 next_tick_to_awake 반환 */
+int64_t get_next_tick_to_awake(void); /* 슬립큐에서 가장 먼저 깨어날 tick 반환 */
 
+/* 스레드의 우선 순위를 변경하고, READY 상태라면 run queue 내 위치도 옮긴다 */
+void thread_update_priority (struct thread *t, int new_priority);
 /* 현재 수행 중인 스레드와 가장 높은 우선 순위의 스레드의 우선순위를 비교하여 스케줄링 */
 void test_max_priority (void);
 /* 인자로 주어진 스레드들의 우선 순위를 비교 */
 bool cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 
 void donate_priority (void); /* nested donation에 사용 됨*/
-void remove_with_lock (struct lock *lock); /* 해제한 lock을 기다리는 스레드들을 donations에서 삭제 */
+void remove_with_lock (struct lock *lock); /* 해제한 lock을 held_locks에서 삭제 */
 void refresh_priority (void); /* 스레드 priority 초기화 */
 
 void mlfqs_priority (struct thread * t); /* Multi-level feedback queue */
@@ -184,6 +208,7 @@ void mlfqs_recent_cpu (struct thread * t);
 void mlfqs_load_avg (void);
 void mlfqs_increment (void);
 void mlfqs_recalc (void);
+void mlfqs_sweep (void);
 /* thread_mlfqs 값을 알기 위해 규정 외 함수 추가 */
 bool get_thread_mlfqs (void);
 
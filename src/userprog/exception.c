@@ -5,6 +5,9 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "userprog/syscall.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -149,6 +152,18 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Bring in a page that is in the supplemental page table but
+     not loaded yet, or grow the stack.  A fault in the kernel
+     on a user address comes from a system call touching a user
+     buffer, so the stack pointer to check against is the one
+     saved on entry to the system call. */
+  if (not_present
+      && page_fault_in (fault_addr,
+                        user ? f->esp : thread_current ()->user_esp))
+    return;
+#endif
+
   /* 페이지 폴트 발생 시 exit(-1) 호출 */
   sys_exit(-1);
 
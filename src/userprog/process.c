@@ -18,6 +18,9 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
@@ -206,7 +209,8 @@ void
 remove_child_process (struct thread *p)
 {
   list_remove(&p->child);
-  palloc_free_page ((void *) p);
+  /* 스레드 페이지와 fd 테이블은 자식이 완전히 종료된 뒤 thread.c가 해제한다 */
+  thread_release (p);
 }
 
 /* Waits for thread TID to die and returns its exit status.  If
@@ -251,7 +255,8 @@ struct file *
 process_get_file (int fd)
 {
   /* 16-11-30 NULL 처리 추가 */
-  if (fd < 0) {
+  /* 열린 적 없는 fd는 테이블 범위 밖이므로 NULL */
+  if (fd < 0 || (uint32_t) fd >= thread_current ()->fd_size) {
     return NULL;
   }
   struct file *f = thread_current ()->fd_table[fd];
@@ -261,7 +266,7 @@ process_get_file (int fd)
 void process_close_file (int fd)
 {
   /* 16-11-30 NULL 처리 추가 */
-  if (fd < 0) {
+  if (fd < 0 || (uint32_t) fd >= thread_current ()->fd_size) {
     return NULL;
   }
   struct file *f = process_get_file(fd);
@@ -287,8 +292,17 @@ process_exit (void)
   /* 실행 중인 파일 close */
   file_close(cur->run_file);
 
-  /* 파일 디스크립터 메모리 테이블 해제 */
-  palloc_free_page ((void *) cur->fd_table);
+  /* 파일 디스크립터 메모리 테이블은 스레드 페이지와 함께 회수된다 */
+
+  /* 종료 상태를 회수하지 않은 자식들에 대한 참조를 놓는다 */
+  while (!list_empty (&cur->children))
+    remove_child_process (list_entry (list_front (&cur->children),
+                                      struct thread, child));
+
+#ifdef VM
+  /* 보조 페이지 테이블 해제. 페이지가 차지한 프레임과 스왑 슬롯도 함께 반납 */
+  page_table_destroy ();
+#endif
 
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
@@ -416,6 +430,10 @@ load (const char *file_name, void (**eip) (void), void **esp)
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  if (!page_table_init ())
+    goto done;
+#endif
 
 
   lock_acquire (&l);  // lock 획득
@@ -523,7 +541,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -582,6 +602,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With VM, the pages are only recorded in the supplemental page
+   table here, and each one is read or zeroed when the process
+   first touches it.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -592,6 +616,26 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifdef VM
+  while (read_bytes > 0 || zero_bytes > 0) 
+    {
+      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+      size_t page_zero_bytes = PGSIZE - page_read_bytes;
+      bool ok = (page_read_bytes > 0
+                 ? page_add_file (upage, file, ofs, page_read_bytes, writable)
+                 : page_add_zero (upage, writable));
+
+      if (!ok)
+        return false;
+
+      /* Advance. */
+      read_bytes -= page_read_bytes;
+      zero_bytes -= page_zero_bytes;
+      ofs += page_read_bytes;
+      upage += PGSIZE;
+    }
+  return true;
+#else
   file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
@@ -627,6 +671,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       upage += PGSIZE;
     }
   return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
@@ -634,6 +679,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp) 
 {
+#ifdef VM
+  /* The arguments are written to the stack right away, so map it
+     now instead of waiting for a fault. */
+  if (!page_add_anon (((uint8_t *) PHYS_BASE) - PGSIZE))
+    return false;
+  *esp = PHYS_BASE;
+  return true;
+#else
   uint8_t *kpage;
   bool success = false;
 
@@ -647,8 +700,10 @@ setup_stack (void **esp)
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -668,3 +723,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
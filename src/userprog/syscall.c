@@ -6,6 +6,10 @@
 #include <devices/shutdown.h>
 #include <filesys/filesys.h>
 #include "userprog/process.h"
+#ifdef VM
+#include "threads/vaddr.h"
+#include "vm/page.h"
+#endif
 
 static void syscall_handler (struct intr_frame *);
 
@@ -25,14 +29,18 @@ void sys_close (int fd);
 
 void check_address(void *addr);
 void get_argument(void *esp, int *arg, int count);
+#ifdef VM
+static void pin_buffer (const void *buffer, unsigned size, bool write);
+static void unpin_buffer (const void *buffer, unsigned size);
+#endif
 
-struct lock l;
+struct lock filesys_lock;
 
 /* See lib/syscall-nr.h */
 void
 syscall_init (void) 
 {
-  lock_init(&l);
+  lock_init(&filesys_lock);
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -42,6 +50,10 @@ syscall_handler (struct intr_frame *f)
   // printf ("system call!\n");
   /* slide 102 복붙 ^0^ */
   uint32_t *esp = f->esp;
+#ifdef VM
+  /* 커널 모드에서 사용자 스택에 페이지 폴트가 나면 이 값으로 스택 확장 여부를 판단 */
+  thread_current ()->user_esp = f->esp;
+#endif
   check_address ((void *) esp);
   int sys_no = *esp;
   int arg[4];
@@ -160,18 +172,18 @@ void sys_exit(int status)
 bool sys_create(const char *file, unsigned initial_size)
 {
   check_address ((void *) file);
-  lock_acquire (&l);
+  lock_acquire (&filesys_lock);
   bool success = filesys_create(file, (off_t) initial_size);
-  lock_release (&l);
+  lock_release (&filesys_lock);
   return success;
 }
 
 bool sys_remove(const char *file)
 {
   check_address ((void *) file);
-  lock_acquire (&l);
+  lock_acquire (&filesys_lock);
   bool success = filesys_remove(file);
-  lock_release (&l);
+  lock_release (&filesys_lock);
   return success;
 }
 
@@ -206,14 +218,14 @@ int
 sys_open (const char *file)
 {
   check_address ((void *) file);
-  lock_acquire (&l);
+  lock_acquire (&filesys_lock);
   struct file *f = filesys_open (file);
   if (f == NULL) {
-    lock_release (&l);
+    lock_release (&filesys_lock);
     return -1;
   }
   int fd = process_add_file (f);
-  lock_release (&l);
+  lock_release (&filesys_lock);
   return fd;
 }
 
@@ -224,9 +236,9 @@ sys_filesize (int fd)
   if (f == NULL) {
     return -1;
   }
-  lock_acquire (&l);
+  lock_acquire (&filesys_lock);
   int size = (int) file_length (f);
-  lock_release (&l);
+  lock_release (&filesys_lock);
   return size;
 }
 
@@ -249,10 +261,16 @@ sys_read (int fd, void *buffer, unsigned size)
     if (f == NULL) {
       return -1;
     }
-    lock_acquire (&l);
+#ifdef VM
+    pin_buffer (buffer, size, true);
+#endif
+    lock_acquire (&filesys_lock);
     /* 파일에 데이터를 크기만큼 저장 후 읽은 바이트 수를 리턴 */
     bytes = (int) file_read (f, buffer, size);
-    lock_release (&l);
+    lock_release (&filesys_lock);
+#ifdef VM
+    unpin_buffer (buffer, size);
+#endif
     return bytes;
   }
 }
@@ -273,10 +291,16 @@ sys_write (int fd, void *buffer, unsigned size)
       return -1;
     }
 
-    lock_acquire (&l);
+#ifdef VM
+    pin_buffer (buffer, size, false);
+#endif
+    lock_acquire (&filesys_lock);
     /* 버퍼에 저장된 데이터를 크기만큼 파일에 기록 후 기록한 바이트 수를 리턴 */
     off_t bytes = file_write (f, buffer, size);
-    lock_release (&l);
+    lock_release (&filesys_lock);
+#ifdef VM
+    unpin_buffer (buffer, size);
+#endif
     return bytes;
   }
 }
@@ -288,9 +312,9 @@ sys_seek (int fd, unsigned position)
   if (f == NULL) {
     return;
   }
-  lock_acquire (&l);
+  lock_acquire (&filesys_lock);
   file_seek (f, (off_t) position);
-  lock_release (&l);
+  lock_release (&filesys_lock);
   return;
 }
 
@@ -301,18 +325,18 @@ sys_tell (int fd)
   if (f == NULL) {
     return -1;
   }
-  lock_acquire (&l);
+  lock_acquire (&filesys_lock);
   unsigned pos = (unsigned) file_tell (f);
-  lock_release (&l);
+  lock_release (&filesys_lock);
   return pos;
 }
 
 void
 sys_close (int fd)
 {
-  lock_acquire (&l);
+  lock_acquire (&filesys_lock);
   process_close_file (fd);
-  lock_release (&l);
+  lock_release (&filesys_lock);
 }
 
 void
@@ -338,4 +362,40 @@ get_argument(void *esp, int *arg, int count)
     arg[i] = * (uint32_t *) esp;
     esp += 4;
   }
-}
\ No newline at end of file
+}
+#ifdef VM
+/* 파일 시스템이 디스크와 직접 주고받는 사용자 버퍼는 입출력 도중
+ * 쫓겨나거나 폴트가 나면 안 되므로 미리 올려서 고정한다.
+ * 잘못된 주소거나 읽기 전용 페이지에 쓰려 하면 프로세스 종료 */
+static void
+pin_buffer (const void *buffer, unsigned size, bool write)
+{
+  const uint8_t *upage;
+
+  if (size == 0)
+    return;
+  for (upage = pg_round_down (buffer);
+       upage <= (const uint8_t *) buffer + size - 1; upage += PGSIZE)
+    if (!page_pin (upage, write))
+      {
+        /* 이미 고정한 페이지는 풀어 주고 종료. 공유 프레임은
+         * 프로세스가 끝나도 남으므로 고정된 채로 두면 안 된다 */
+        if (upage != pg_round_down (buffer))
+          unpin_buffer (buffer, upage - (const uint8_t *) buffer);
+        sys_exit (-1);
+      }
+}
+
+/* pin_buffer () 로 고정한 페이지들을 다시 쫓겨날 수 있게 푼다 */
+static void
+unpin_buffer (const void *buffer, unsigned size)
+{
+  const uint8_t *upage;
+
+  if (size == 0)
+    return;
+  for (upage = pg_round_down (buffer);
+       upage <= (const uint8_t *) buffer + size - 1; upage += PGSIZE)
+    page_unpin (upage);
+}
+#endif
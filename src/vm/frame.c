@@ -0,0 +1,314 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <hashmap.h>
+#include <string.h>
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+struct lock frame_lock;
+
+/* Frame table: every frame in use, in clock order. */
+static struct list frames;
+
+/* Number of frames in FRAMES. */
+static size_t frame_cnt;
+
+/* Clock hand: the next frame to consider for eviction, or a
+   null pointer to start over at the front of FRAMES. */
+static struct list_elem *hand;
+
+/* Shared frame table.  Keys are the shared frames themselves,
+   compared by inode, offset and length.  A shared frame stays
+   here after the last process mapping it exits, holding its
+   inode open, so that the next process to run the same program
+   finds its code already in memory. */
+static struct hashmap shared;
+
+static struct frame *evict_frames (struct inode *dead[], size_t *dead_cnt);
+static struct frame *choose_victim (void);
+static bool is_accessed (struct frame *);
+static unsigned shared_hash (uintptr_t, void *aux);
+static bool shared_less (uintptr_t, uintptr_t, void *aux);
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  lock_init (&frame_lock);
+  list_init (&frames);
+  if (!hashmap_init (&shared, shared_hash, shared_less, NULL))
+    PANIC ("couldn't allocate shared frame table");
+}
+
+/* Obtains a private frame to hold PAGE, zeroed if FLAGS includes
+   PAL_ZERO.  If the user pool is empty, evicts some other pages
+   to make room.  Returns the frame, pinned, or a null pointer if
+   no frame could be obtained.  The caller should fill the frame,
+   set PAGE's `frame' member, and then call frame_unpin(). */
+struct frame *
+frame_alloc (struct page *page, enum palloc_flags flags)
+{
+  struct inode *dead[SWAP_CLUSTER];
+  size_t dead_cnt = 0;
+  struct frame *f;
+  void *kpage;
+
+  ASSERT ((flags & ~PAL_ZERO) == 0);
+
+  lock_acquire (&frame_lock);
+  kpage = palloc_get_page (PAL_USER | flags);
+  if (kpage != NULL)
+    {
+      f = malloc (sizeof *f);
+      if (f == NULL)
+        palloc_free_page (kpage);
+      else
+        {
+          f->kpage = kpage;
+          list_init (&f->pages);
+          f->inode = NULL;
+          list_push_back (&frames, &f->elem);
+          frame_cnt++;
+        }
+    }
+  else
+    {
+      /* Take over a victim's frame, keeping its place in the
+         clock. */
+      f = evict_frames (dead, &dead_cnt);
+      if (f != NULL && (flags & PAL_ZERO))
+        memset (f->kpage, 0, PGSIZE);
+    }
+  if (f != NULL)
+    {
+      list_push_back (&f->pages, &page->frame_elem);
+      f->pin_cnt = 1;
+    }
+  lock_release (&frame_lock);
+
+  /* Close the inodes of shared frames that were evicted.  That
+     needs filesys_lock, which eviction cannot take. */
+  if (dead_cnt > 0)
+    {
+      bool held = lock_held_by_current_thread (&filesys_lock);
+      size_t i;
+
+      if (!held)
+        lock_acquire (&filesys_lock);
+      for (i = 0; i < dead_cnt; i++)
+        inode_close (dead[i]);
+      if (!held)
+        lock_release (&filesys_lock);
+    }
+
+  return f;
+}
+
+/* Removes F, which must be private, from the frame table and
+   frees it along with its page.  The caller must hold frame_lock
+   and must already have unmapped the page it holds. */
+void
+frame_free (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (f->inode == NULL);
+
+  if (hand == &f->elem)
+    hand = list_remove (&f->elem);
+  else
+    list_remove (&f->elem);
+  frame_cnt--;
+  palloc_free_page (f->kpage);
+  free (f);
+}
+
+/* Undoes one pin of F. */
+void
+frame_unpin (struct frame *f)
+{
+  lock_acquire (&frame_lock);
+  ASSERT (f->pin_cnt > 0);
+  f->pin_cnt--;
+  lock_release (&frame_lock);
+}
+
+/* Returns the shared frame holding READ_BYTES bytes read from
+   INODE at offset OFS, followed by zeros, or a null pointer if
+   there is none.  The caller must hold frame_lock. */
+struct frame *
+frame_find_shared (struct inode *inode, off_t ofs, uint32_t read_bytes)
+{
+  struct frame key;
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  key.inode = inode;
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+  f = hashmap_find (&shared, (uintptr_t) &key);
+  if (f != NULL && f->write_cnt != inode_get_write_cnt (inode))
+    {
+      /* The file was rewritten while no process was running it.
+         Forget F; eviction will free it and close its inode. */
+      hashmap_delete (&shared, (uintptr_t) f);
+      f = NULL;
+    }
+  return f;
+}
+
+/* Makes F, which holds READ_BYTES bytes read from INODE at offset
+   OFS, followed by zeros, a shared frame.  F takes over the
+   caller's reference to INODE.  The caller must hold frame_lock,
+   and frame_find_shared() must have just failed to find a frame
+   for the same bytes. */
+void
+frame_share (struct frame *f, struct inode *inode, off_t ofs,
+             uint32_t read_bytes)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (f->inode == NULL);
+
+  f->inode = inode;
+  f->ofs = ofs;
+  f->read_bytes = read_bytes;
+  f->write_cnt = inode_get_write_cnt (inode);
+
+  /* If this fails, F just cannot be found by other processes. */
+  hashmap_insert (&shared, (uintptr_t) f, f);
+}
+
+/* Evicts up to SWAP_CLUSTER frames chosen by the clock, so that
+   the pages among them that need swapping are written out
+   together.  Keeps one evicted frame for the caller and frees the
+   rest to the user pool, where the next few allocations will
+   find them.  Stores the inodes of evicted shared frames, which
+   the caller must close, into DEAD[] and their number into
+   *DEAD_CNT.  Returns the kept frame, or a null pointer if
+   nothing could be evicted. */
+static struct frame *
+evict_frames (struct inode *dead[], size_t *dead_cnt)
+{
+  struct frame *victims[SWAP_CLUSTER];
+  struct frame *kept = NULL;
+  size_t cnt, i;
+
+  for (cnt = 0; cnt < SWAP_CLUSTER; cnt++)
+    {
+      struct frame *f = choose_victim ();
+      if (f == NULL)
+        break;
+
+      /* Pin it so that choose_victim() passes it over from now
+         on.  frame_lock keeps anyone else from seeing this. */
+      f->pin_cnt++;
+      victims[cnt] = f;
+    }
+  if (cnt == 0)
+    return NULL;
+
+  page_evict (victims, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      struct frame *f = victims[i];
+
+      f->pin_cnt--;
+      if (!list_empty (&f->pages))
+        continue;
+
+      if (f->inode != NULL)
+        {
+          if (hashmap_find (&shared, (uintptr_t) f) == f)
+            hashmap_delete (&shared, (uintptr_t) f);
+          dead[(*dead_cnt)++] = f->inode;
+          f->inode = NULL;
+        }
+      if (kept == NULL)
+        kept = f;
+      else
+        frame_free (f);
+    }
+  return kept;
+}
+
+/* Chooses a frame to evict using the clock algorithm: sweeps
+   the frame table, giving each frame whose page was accessed
+   since the last sweep a second chance by clearing its accessed
+   bit.  Returns a null pointer if every frame is pinned. */
+static struct frame *
+choose_victim (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  /* Two sweeps clear every accessed bit on the way round, so by
+     then an unpinned frame must have turned up. */
+  for (i = 0; i < 2 * frame_cnt; i++)
+    {
+      struct frame *f;
+
+      if (hand == NULL || hand == list_end (&frames))
+        hand = list_begin (&frames);
+      f = list_entry (hand, struct frame, elem);
+      hand = list_next (hand);
+
+      if (f->pin_cnt == 0 && !is_accessed (f))
+        return f;
+    }
+  return NULL;
+}
+
+/* Returns true if any process mapping F has accessed it since
+   the last call, clearing the accessed bits. */
+static bool
+is_accessed (struct frame *f)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+
+      if (pagedir_is_accessed (p->pagedir, p->upage))
+        {
+          pagedir_set_accessed (p->pagedir, p->upage, false);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Returns a hash of shared frame F's inode, offset and
+   length. */
+static unsigned
+shared_hash (uintptr_t f_, void *aux UNUSED)
+{
+  const struct frame *f = (const struct frame *) f_;
+
+  return hashmap_hash_uint ((uintptr_t) f->inode
+                            ^ ((uintptr_t) f->ofs * 31 + f->read_bytes),
+                            NULL);
+}
+
+/* Returns true if shared frame A sorts before shared frame B by
+   inode, offset and length. */
+static bool
+shared_less (uintptr_t a_, uintptr_t b_, void *aux UNUSED)
+{
+  const struct frame *a = (const struct frame *) a_;
+  const struct frame *b = (const struct frame *) b_;
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  return a->read_bytes < b->read_bytes;
+}
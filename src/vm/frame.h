@@ -0,0 +1,57 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+
+struct inode;
+struct page;
+
+/* A frame: a page from the user pool that holds a user page.
+
+   Every frame is in the global frame table, which the clock
+   hand sweeps to pick a frame to evict when the user pool runs
+   dry.  A pinned frame is never evicted; frames are pinned while
+   they are being filled and while the kernel is doing I/O on
+   them on behalf of a system call.
+
+   A private frame is mapped by exactly one page.  A shared frame
+   holds a read-only page of an executable and is mapped by every
+   process that has faulted in that page, by zero processes if
+   they have all exited. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address of frame. */
+    struct list pages;          /* Pages mapped to this frame. */
+    unsigned pin_cnt;           /* Exempt from eviction if nonzero. */
+    struct list_elem elem;      /* Element in frame table. */
+
+    /* Shared frames only. */
+    struct inode *inode;        /* Inode read, or null if private. */
+    off_t ofs;                  /* Offset in INODE. */
+    uint32_t read_bytes;        /* Bytes read; the rest are zeros. */
+    unsigned write_cnt;         /* INODE's write count when read. */
+  };
+
+/* Protects the frame table, the shared frame table, the members
+   of each frame, and the `frame', `frame_elem' and `swap_slot'
+   members of every struct page.  Held for the whole of an
+   eviction, so no other lock that eviction might need may be
+   acquired while holding it.  In particular, filesys_lock must
+   be acquired first if both are needed. */
+extern struct lock frame_lock;
+
+void frame_init (void);
+struct frame *frame_alloc (struct page *, enum palloc_flags);
+void frame_free (struct frame *);
+void frame_unpin (struct frame *);
+struct frame *frame_find_shared (struct inode *, off_t ofs,
+                                 uint32_t read_bytes);
+void frame_share (struct frame *, struct inode *, off_t ofs,
+                  uint32_t read_bytes);
+
+#endif /* vm/frame.h */
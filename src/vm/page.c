@@ -0,0 +1,511 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <hashmap.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+static struct page *add_page (void *upage, enum page_type, bool writable);
+static void remove_page (struct page *);
+static bool page_less (const struct page *, const struct page *);
+static bool grow_stack (void *addr, void *esp);
+static bool is_loaded (struct page *);
+static bool load_page (struct page *, bool pin);
+static bool map_shared (struct page *, bool pin);
+static bool read_page (struct page *, void *kpage);
+static void share_page (struct page *, struct frame *);
+static void destroy_page (uintptr_t upage, void *page, void *aux);
+
+/* Initializes the current process's supplemental page table.
+   Returns true if successful, false if memory could not be
+   allocated. */
+bool
+page_table_init (void)
+{
+  return hashmap_init (&thread_current ()->pages,
+                       hashmap_hash_uint, hashmap_less_uint, NULL);
+}
+
+/* Frees the current process's supplemental page table, along
+   with the frames and swap slots that hold its pages. */
+void
+page_table_destroy (void)
+{
+  hashmap_destroy (&thread_current ()->pages, destroy_page);
+}
+
+/* Records that the page at UPAGE in the current process is to
+   be loaded on first access by reading READ_BYTES bytes from
+   FILE starting at offset OFS and zeroing the rest of the page.
+   Returns true if successful, false if UPAGE is already in use
+   or memory could not be allocated. */
+bool
+page_add_file (void *upage, struct file *file, off_t ofs,
+               uint32_t read_bytes, bool writable)
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = add_page (upage, PAGE_FILE, writable);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->file_ofs = ofs;
+  p->read_bytes = read_bytes;
+  return true;
+}
+
+/* Records that the page at UPAGE in the current process is to
+   be zeroed on first access.  Returns true if successful, false
+   if UPAGE is already in use or memory could not be
+   allocated. */
+bool
+page_add_zero (void *upage, bool writable)
+{
+  return add_page (upage, PAGE_ZERO, writable) != NULL;
+}
+
+/* Maps a new, zeroed, writable page at UPAGE in the current
+   process right away.  Returns true if successful, false if
+   UPAGE is already in use or memory could not be allocated. */
+bool
+page_add_anon (void *upage)
+{
+  struct page *p = add_page (upage, PAGE_ANON, true);
+  struct frame *f;
+
+  if (p == NULL)
+    return false;
+
+  f = frame_alloc (p, PAL_ZERO);
+  if (f == NULL)
+    {
+      remove_page (p);
+      return false;
+    }
+  if (!pagedir_set_page (p->pagedir, upage, f->kpage, true))
+    {
+      lock_acquire (&frame_lock);
+      frame_free (f);
+      lock_release (&frame_lock);
+      remove_page (p);
+      return false;
+    }
+
+  lock_acquire (&frame_lock);
+  p->frame = f;
+  f->pin_cnt--;
+  lock_release (&frame_lock);
+  return true;
+}
+
+/* Returns the current process's page that contains user virtual
+   address ADDR, or a null pointer if there is none. */
+struct page *
+page_lookup (const void *addr)
+{
+  return hashmap_find (&thread_current ()->pages,
+                       (uintptr_t) pg_round_down (addr));
+}
+
+/* Handles a fault on a not-present page at FAULT_ADDR in the
+   current process, whose user stack pointer is ESP.  Loads the
+   page if it is recorded in the supplemental page table but not
+   in a frame, or maps a new stack page if FAULT_ADDR looks like
+   a stack access.  Returns true if the faulting access may be
+   retried, false if it was invalid. */
+bool
+page_fault_in (void *fault_addr, void *esp)
+{
+  struct page *p;
+
+  if (fault_addr == NULL || !is_user_vaddr (fault_addr))
+    return false;
+
+  p = page_lookup (fault_addr);
+  if (p == NULL)
+    return grow_stack (fault_addr, esp);
+  /* A page in a frame was unmapped by page_evict() while we
+     faulted, then mapped back in because swap was full, so the
+     access will succeed when retried. */
+  if (is_loaded (p))
+    return true;
+  return load_page (p, false);
+}
+
+/* Brings the page containing user virtual address ADDR into a
+   frame, if it is not there already, and pins it so that it
+   stays there until page_unpin().  System calls pin the user
+   buffers they pass to the file system, which must not fault
+   while holding device locks.  If WRITE is true, the page must
+   be writable.  Returns true if successful, false if ADDR is not
+   a valid address for such an access. */
+bool
+page_pin (const void *addr, bool write)
+{
+  struct page *p;
+
+  if (addr == NULL || !is_user_vaddr (addr))
+    return false;
+
+  p = page_lookup (addr);
+  if (p == NULL)
+    {
+      if (!grow_stack ((void *) addr, thread_current ()->user_esp))
+        return false;
+      p = page_lookup (addr);
+    }
+  if (write && !p->writable)
+    return false;
+
+  lock_acquire (&frame_lock);
+  if (p->frame != NULL)
+    {
+      p->frame->pin_cnt++;
+      lock_release (&frame_lock);
+      return true;
+    }
+  lock_release (&frame_lock);
+  return load_page (p, true);
+}
+
+/* Unpins the page containing ADDR, which was pinned with
+   page_pin(). */
+void
+page_unpin (const void *addr)
+{
+  struct page *p = page_lookup (addr);
+
+  lock_acquire (&frame_lock);
+  if (p != NULL && p->frame != NULL)
+    {
+      ASSERT (p->frame->pin_cnt > 0);
+      p->frame->pin_cnt--;
+    }
+  lock_release (&frame_lock);
+}
+
+/* Removes the pages in the CNT frames in FRAMES, which may
+   belong to any processes, from those frames, writing to swap
+   those whose contents could not otherwise be recreated.  The
+   pages written go out in one cluster, sorted by page directory
+   and address, so that virtually adjacent pages land in adjacent
+   slots and swap-in readahead can find them.  A page for which
+   no swap slot can be found keeps its frame; the other frames
+   end up with empty `pages' lists.  CNT must not exceed
+   SWAP_CLUSTER.  The caller must hold frame_lock. */
+void
+page_evict (struct frame *frames[], size_t cnt)
+{
+  struct page *out[SWAP_CLUSTER];
+  const void *kpages[SWAP_CLUSTER];
+  size_t out_cnt = 0;
+  size_t first;
+  size_t i, j;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (cnt <= SWAP_CLUSTER);
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct frame *f = frames[i];
+      struct list_elem *e;
+      struct page *p;
+      bool dirty = false;
+
+      /* Unmap first, so that no process can dirty the page
+         after we look at the dirty bit.  Accessing the page now
+         faults, and the fault handler waits on frame_lock. */
+      for (e = list_begin (&f->pages); e != list_end (&f->pages);
+           e = list_next (e))
+        {
+          p = list_entry (e, struct page, frame_elem);
+          pagedir_clear_page (p->pagedir, p->upage);
+          if (pagedir_is_dirty (p->pagedir, p->upage))
+            dirty = true;
+        }
+      if (list_empty (&f->pages))
+        continue;
+
+      /* Shared frames are read-only, hence clean. */
+      p = list_entry (list_front (&f->pages), struct page, frame_elem);
+      if (f->inode != NULL || (p->type != PAGE_ANON && !dirty))
+        {
+          while (!list_empty (&f->pages))
+            {
+              e = list_pop_front (&f->pages);
+              list_entry (e, struct page, frame_elem)->frame = NULL;
+            }
+          continue;
+        }
+
+      /* Insertion sort into OUT. */
+      for (j = out_cnt; j > 0 && page_less (p, out[j - 1]); j--)
+        out[j] = out[j - 1];
+      out[j] = p;
+      out_cnt++;
+    }
+  if (out_cnt == 0)
+    return;
+
+  for (i = 0; i < out_cnt; i++)
+    kpages[i] = out[i]->frame->kpage;
+  first = swap_out (kpages, out_cnt);
+  for (i = 0; i < out_cnt; i++)
+    {
+      struct page *p = out[i];
+      size_t slot = first != SWAP_ERROR ? first + i : SWAP_ERROR;
+
+      /* Swap may be too fragmented for a whole cluster. */
+      if (slot == SWAP_ERROR && out_cnt > 1)
+        slot = swap_out (&kpages[i], 1);
+      if (slot == SWAP_ERROR)
+        {
+          /* The dirty bit is lost on remapping, but the page is
+             anonymous or was dirty, so setting it is right. */
+          pagedir_set_page (p->pagedir, p->upage, p->frame->kpage,
+                            p->writable);
+          pagedir_set_dirty (p->pagedir, p->upage, true);
+          continue;
+        }
+      p->type = PAGE_ANON;
+      p->swap_slot = slot;
+      list_remove (&p->frame_elem);
+      p->frame = NULL;
+    }
+}
+
+/* Creates a page of the given TYPE for UPAGE and adds it to the
+   current process's supplemental page table, without loading
+   it.  Returns the page, or a null pointer if UPAGE is already
+   in use or memory could not be allocated. */
+static struct page *
+add_page (void *upage, enum page_type type, bool writable)
+{
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->pagedir = thread_current ()->pagedir;
+  p->type = type;
+  p->writable = writable;
+  p->frame = NULL;
+  p->swap_slot = SWAP_ERROR;
+  p->file = NULL;
+  p->file_ofs = 0;
+  p->read_bytes = 0;
+
+  if (!hashmap_insert (&thread_current ()->pages, (uintptr_t) upage, p))
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Removes P from the current process's supplemental page table
+   and frees it.  P must not be loaded. */
+static void
+remove_page (struct page *p)
+{
+  ASSERT (p->frame == NULL);
+
+  hashmap_delete (&thread_current ()->pages, (uintptr_t) p->upage);
+  free (p);
+}
+
+/* Returns true if page A sorts before page B in swap order:
+   by page directory, then by address. */
+static bool
+page_less (const struct page *a, const struct page *b)
+{
+  if (a->pagedir != b->pagedir)
+    return a->pagedir < b->pagedir;
+  return a->upage < b->upage;
+}
+
+/* Maps a new stack page for ADDR in the current process, whose
+   user stack pointer is ESP, if ADDR looks like a stack access.
+   Returns true if successful, false otherwise. */
+static bool
+grow_stack (void *addr, void *esp)
+{
+  /* PUSHA writes up to 32 bytes below the stack pointer before
+     moving it, so accept accesses that far below. */
+  if ((uint8_t *) addr >= (uint8_t *) esp - 32
+      && (uint8_t *) addr >= (uint8_t *) PHYS_BASE - STACK_MAX)
+    return page_add_anon (pg_round_down (addr));
+  return false;
+}
+
+/* Returns true if P is in a frame.  If an eviction of P is under
+   way, waits for it to finish first. */
+static bool
+is_loaded (struct page *p)
+{
+  bool loaded;
+
+  lock_acquire (&frame_lock);
+  loaded = p->frame != NULL;
+  lock_release (&frame_lock);
+  return loaded;
+}
+
+/* Obtains a frame for P, fills it with P's contents, and maps it
+   in P's page directory.  Leaves the frame pinned if PIN is
+   true.  Returns true if successful, false if memory could not
+   be allocated or the file could not be read. */
+static bool
+load_page (struct page *p, bool pin)
+{
+  bool shareable = p->type == PAGE_FILE && !p->writable;
+  struct frame *f;
+
+  ASSERT (p->frame == NULL);
+
+  if (shareable && map_shared (p, pin))
+    return true;
+
+  f = frame_alloc (p, p->type == PAGE_ZERO ? PAL_ZERO : 0);
+  if (f == NULL)
+    return false;
+
+  if (p->type == PAGE_FILE)
+    {
+      if (!read_page (p, f->kpage))
+        goto error;
+    }
+  else if (p->type == PAGE_ANON)
+    {
+      ASSERT (p->swap_slot != SWAP_ERROR);
+      swap_in (p->swap_slot, f->kpage);
+      p->swap_slot = SWAP_ERROR;
+    }
+
+  if (!pagedir_set_page (p->pagedir, p->upage, f->kpage, p->writable))
+    goto error;
+  if (shareable)
+    share_page (p, f);
+
+  lock_acquire (&frame_lock);
+  p->frame = f;
+  if (!pin)
+    f->pin_cnt--;
+  lock_release (&frame_lock);
+  return true;
+
+ error:
+  lock_acquire (&frame_lock);
+  frame_free (f);
+  lock_release (&frame_lock);
+  return false;
+}
+
+/* Maps P, a read-only file page, to the shared frame that holds
+   the same bytes of the same file, if there is one, pinning it
+   if PIN is true.  Returns true if successful, false if there is
+   no such frame or memory could not be allocated. */
+static bool
+map_shared (struct page *p, bool pin)
+{
+  struct frame *f;
+  bool success = false;
+
+  lock_acquire (&frame_lock);
+  f = frame_find_shared (file_get_inode (p->file), p->file_ofs,
+                         p->read_bytes);
+  if (f != NULL
+      && pagedir_set_page (p->pagedir, p->upage, f->kpage, false))
+    {
+      list_push_back (&f->pages, &p->frame_elem);
+      p->frame = f;
+      if (pin)
+        f->pin_cnt++;
+      success = true;
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Reads P, a file page, into KPAGE and zeroes the rest of the
+   page.  Returns true if successful, false if the file could not
+   be read. */
+static bool
+read_page (struct page *p, void *kpage)
+{
+  /* A system call that faults on a user buffer may already hold
+     the file system lock. */
+  bool held = lock_held_by_current_thread (&filesys_lock);
+  off_t bytes_read;
+
+  if (!held)
+    lock_acquire (&filesys_lock);
+  bytes_read = file_read_at (p->file, kpage, p->read_bytes, p->file_ofs);
+  if (!held)
+    lock_release (&filesys_lock);
+
+  if (bytes_read != (off_t) p->read_bytes)
+    return false;
+  memset ((uint8_t *) kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+  return true;
+}
+
+/* Makes F, which P has just been read into, a shared frame that
+   other processes running the same executable can map, unless
+   another process read the same page in the meantime, in which
+   case F stays private to P. */
+static void
+share_page (struct page *p, struct frame *f)
+{
+  bool held = lock_held_by_current_thread (&filesys_lock);
+  struct inode *inode = file_get_inode (p->file);
+
+  /* inode_reopen() needs filesys_lock, which must be acquired
+     before frame_lock. */
+  if (!held)
+    lock_acquire (&filesys_lock);
+  lock_acquire (&frame_lock);
+  if (frame_find_shared (inode, p->file_ofs, p->read_bytes) == NULL)
+    frame_share (f, inode_reopen (inode), p->file_ofs, p->read_bytes);
+  lock_release (&frame_lock);
+  if (!held)
+    lock_release (&filesys_lock);
+}
+
+/* Frees PAGE, a struct page in the current process's
+   supplemental page table, along with its frame or swap slot.
+   A shared frame stays in memory after its last page is gone, so
+   that later runs of the same executable can map it. */
+static void
+destroy_page (uintptr_t upage UNUSED, void *page, void *aux UNUSED)
+{
+  struct page *p = page;
+
+  lock_acquire (&frame_lock);
+  if (p->frame != NULL)
+    {
+      struct frame *f = p->frame;
+
+      pagedir_clear_page (p->pagedir, p->upage);
+      list_remove (&p->frame_elem);
+      if (f->inode == NULL)
+        frame_free (f);
+    }
+  else if (p->swap_slot != SWAP_ERROR)
+    swap_free (p->swap_slot);
+  lock_release (&frame_lock);
+  free (p);
+}
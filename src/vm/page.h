@@ -0,0 +1,70 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+/* Where a page's initial contents come from. */
+enum page_type
+  {
+    PAGE_FILE,          /* Read from a file, zero-padded (code, data). */
+    PAGE_ZERO,          /* All zeros (bss). */
+    PAGE_ANON           /* Swap only (stack, evicted dirty pages). */
+  };
+
+/* Supplemental page table entry.
+
+   Describes one page of a process's user virtual address space:
+   where to get its contents and which frame, if any, holds it.
+   Each process keeps its entries in the `pages' map in its
+   struct thread, keyed by user virtual address.  Pages of type
+   PAGE_FILE and PAGE_ZERO are recorded when the executable is
+   loaded but not read or zeroed until the process first touches
+   them.
+
+   A page may be evicted from its frame at any time unless the
+   frame is pinned.  Clean PAGE_FILE and PAGE_ZERO pages are
+   simply dropped and recreated on the next fault.  Other pages
+   are written to swap, and from then on they are PAGE_ANON,
+   because their contents no longer match their origin.
+
+   Read-only PAGE_FILE pages share a frame with every other
+   process's page for the same bytes of the same file. */
+struct page
+  {
+    void *upage;                /* User virtual address of page. */
+    uint32_t *pagedir;          /* Page directory that maps it. */
+    enum page_type type;        /* Source of contents. */
+    bool writable;              /* Writable by the process? */
+
+    /* Protected by frame_lock. */
+    struct frame *frame;        /* Frame holding page, if loaded. */
+    struct list_elem frame_elem; /* Element in frame's `pages' list. */
+    size_t swap_slot;           /* Swap slot, or SWAP_ERROR. */
+
+    /* PAGE_FILE only. */
+    struct file *file;          /* File to read. */
+    off_t file_ofs;             /* Offset of page in FILE. */
+    uint32_t read_bytes;        /* Bytes to read; the rest are zeroed. */
+  };
+
+/* Maximum size of a process's stack, in bytes. */
+#define STACK_MAX (8 * 1024 * 1024)
+
+bool page_table_init (void);
+void page_table_destroy (void);
+
+bool page_add_file (void *upage, struct file *, off_t ofs,
+                    uint32_t read_bytes, bool writable);
+bool page_add_zero (void *upage, bool writable);
+bool page_add_anon (void *upage);
+struct page *page_lookup (const void *addr);
+bool page_fault_in (void *fault_addr, void *esp);
+bool page_pin (const void *addr, bool write);
+void page_unpin (const void *addr);
+void page_evict (struct frame *frames[], size_t cnt);
+
+#endif /* vm/page.h */
@@ -0,0 +1,237 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Number of sectors in a swap slot, which holds one page. */
+#define SLOT_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Number of pages in the swap cache. */
+#define CACHE_SIZE 32
+
+/* Swap device, or a null pointer if there is none. */
+static struct block *swap_device;
+
+/* Swap slots in use, one bit per slot. */
+static struct bitmap *used_slots;
+
+/* The swap cache holds copies of in-use slots that were read
+   ahead of a fault on an earlier slot.  Entries are replaced
+   round robin. */
+struct cache_entry
+  {
+    size_t slot;                /* Slot cached here, or SWAP_ERROR. */
+    void *kpage;                /* Copy of slot, allocated on demand. */
+  };
+static struct cache_entry cache[CACHE_SIZE];
+static size_t cache_hand;       /* Next entry to replace. */
+
+/* Protects USED_SLOTS, CACHE, and the statistics. */
+static struct lock swap_lock;
+
+size_t swap_readahead = 7;
+
+/* Statistics. */
+static long long pages_out;     /* Pages written. */
+static long long clusters_out;  /* Calls to swap_out() that wrote. */
+static long long ra_reads;      /* Slots read ahead into the cache. */
+static long long cache_hits;    /* Swap-ins served from the cache. */
+static long long cache_misses;  /* Swap-ins that read the device. */
+
+static struct cache_entry *cache_lookup (size_t slot);
+static struct cache_entry *cache_get_entry (void);
+static void read_ahead (size_t slot);
+static void read_slot (size_t slot, void *kpage);
+static void write_slot (size_t slot, const void *kpage);
+
+/* Initializes the swap slot allocator.  Without a BLOCK_SWAP
+   device there are no slots, so every swap_out() fails. */
+void
+swap_init (void)
+{
+  size_t slot_cnt = 0;
+  size_t i;
+
+  lock_init (&swap_lock);
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL)
+    slot_cnt = block_size (swap_device) / SLOT_SECTORS;
+  used_slots = bitmap_create (slot_cnt);
+  if (used_slots == NULL)
+    PANIC ("couldn't allocate swap bitmap");
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    cache[i].slot = SWAP_ERROR;
+}
+
+/* Writes the CNT pages in KPAGES to CNT consecutive free swap
+   slots, KPAGES[0] to the first.  Returns the first slot, or
+   SWAP_ERROR if there is no run of CNT free slots. */
+size_t
+swap_out (const void *kpages[], size_t cnt)
+{
+  size_t slot;
+  size_t i;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (used_slots, 0, cnt, false);
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_ERROR;
+
+  for (i = 0; i < cnt; i++)
+    write_slot (slot + i, kpages[i]);
+
+  /* Readahead may have cached what these slots held before we
+     wrote them, so drop any such copies now that the writes are
+     done. */
+  lock_acquire (&swap_lock);
+  for (i = 0; i < cnt; i++)
+    {
+      struct cache_entry *e = cache_lookup (slot + i);
+      if (e != NULL)
+        e->slot = SWAP_ERROR;
+    }
+  pages_out += cnt;
+  clusters_out++;
+  lock_release (&swap_lock);
+
+  return slot;
+}
+
+/* Reads swap slot SLOT into the page at KPAGE and frees the
+   slot.  Takes the contents from the swap cache if they were
+   read ahead; otherwise reads SLOT from the device and reads
+   ahead the in-use slots that follow it. */
+void
+swap_in (size_t slot, void *kpage)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  e = cache_lookup (slot);
+  if (e != NULL)
+    {
+      memcpy (kpage, e->kpage, PGSIZE);
+      e->slot = SWAP_ERROR;
+      cache_hits++;
+    }
+  else
+    {
+      read_slot (slot, kpage);
+      read_ahead (slot);
+      cache_misses++;
+    }
+  bitmap_reset (used_slots, slot);
+  lock_release (&swap_lock);
+}
+
+/* Frees swap slot SLOT without reading it. */
+void
+swap_free (size_t slot)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  bitmap_reset (used_slots, slot);
+  e = cache_lookup (slot);
+  if (e != NULL)
+    e->slot = SWAP_ERROR;
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  printf ("Swap: %lld pages out in %lld clusters, %lld read ahead, "
+          "%lld cache hits, %lld misses\n",
+          pages_out, clusters_out, ra_reads, cache_hits, cache_misses);
+}
+
+/* Returns the cache entry holding SLOT, or a null pointer if
+   SLOT is not cached. */
+static struct cache_entry *
+cache_lookup (size_t slot)
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (cache[i].slot == slot)
+      return &cache[i];
+  return NULL;
+}
+
+/* Returns a cache entry to reuse, with a page allocated, or a
+   null pointer if no page could be allocated. */
+static struct cache_entry *
+cache_get_entry (void)
+{
+  struct cache_entry *e = &cache[cache_hand];
+
+  if (e->kpage == NULL)
+    {
+      e->kpage = palloc_get_page (0);
+      if (e->kpage == NULL)
+        return NULL;
+    }
+  cache_hand = (cache_hand + 1) % CACHE_SIZE;
+  e->slot = SWAP_ERROR;
+  return e;
+}
+
+/* Reads into the cache up to swap_readahead in-use slots that
+   follow SLOT and are not cached already.  Clustered swap-out
+   puts virtually adjacent pages in adjacent slots, so these are
+   likely to be faulted in soon. */
+static void
+read_ahead (size_t slot)
+{
+  size_t window = swap_readahead < CACHE_SIZE ? swap_readahead : CACHE_SIZE;
+  size_t end = slot + 1 + window;
+  size_t s;
+
+  if (end > bitmap_size (used_slots))
+    end = bitmap_size (used_slots);
+  for (s = slot + 1; s < end; s++)
+    if (bitmap_test (used_slots, s) && cache_lookup (s) == NULL)
+      {
+        struct cache_entry *e = cache_get_entry ();
+        if (e == NULL)
+          break;
+        read_slot (s, e->kpage);
+        e->slot = s;
+        ra_reads++;
+      }
+}
+
+/* Reads swap slot SLOT into the page at KPAGE. */
+static void
+read_slot (size_t slot, void *kpage)
+{
+  size_t i;
+
+  for (i = 0; i < SLOT_SECTORS; i++)
+    block_read (swap_device, slot * SLOT_SECTORS + i,
+                (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+}
+
+/* Writes the page at KPAGE to swap slot SLOT. */
+static void
+write_slot (size_t slot, const void *kpage)
+{
+  size_t i;
+
+  for (i = 0; i < SLOT_SECTORS; i++)
+    block_write (swap_device, slot * SLOT_SECTORS + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+}
@@ -0,0 +1,24 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returned by swap_out() when swap is full.  Also used as the
+   slot of a page that is not in swap. */
+#define SWAP_ERROR SIZE_MAX
+
+/* Maximum number of pages that one swap_out() writes. */
+#define SWAP_CLUSTER 8
+
+/* Number of slots after a faulting one to read ahead.
+   Set with -swap-ra=COUNT; 0 turns readahead off. */
+extern size_t swap_readahead;
+
+void swap_init (void);
+size_t swap_out (const void *kpages[], size_t cnt);
+void swap_in (size_t slot, void *kpage);
+void swap_free (size_t slot);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */